@@ -0,0 +1,101 @@
+#include <CArena.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+CArena::
+CArena(std::size_t blockSize) :
+ blockSize_(std::max(blockSize, std::size_t(64)))
+{
+}
+
+CArena::
+~CArena()
+{
+  clear();
+}
+
+void *
+CArena::
+alloc(std::size_t bytes, std::size_t align)
+{
+  for (;;) {
+    if (block_ < blocks_.size()) {
+      auto &block = blocks_[block_];
+
+      // align address (not offset) so any alignment is supported
+      auto addr = reinterpret_cast<uintptr_t>(block.data) + pos_;
+      auto pad  = (align - (addr & (align - 1))) & (align - 1);
+
+      if (pos_ + pad + bytes <= block.size) {
+        auto *p = block.data + pos_ + pad;
+
+        pos_  += pad + bytes;
+        used_ += pad + bytes;
+
+        return p;
+      }
+
+      // try next (already allocated) block
+      ++block_;
+
+      pos_ = 0;
+
+      continue;
+    }
+
+    //---
+
+    // add new block (double size of previous block up to max)
+    std::size_t size = blockSize_;
+
+    if (! blocks_.empty())
+      size = std::max(size, std::min(2*blocks_.back().size, MaxBlockSize));
+
+    size = std::max(size, bytes + align);
+
+    Block block;
+
+    block.data = static_cast<char *>(::operator new(size));
+    block.size = size;
+
+    blocks_.push_back(block);
+
+    block_ = blocks_.size() - 1;
+    pos_   = 0;
+  }
+}
+
+void
+CArena::
+reset()
+{
+  block_ = 0;
+  pos_   = 0;
+  used_  = 0;
+}
+
+void
+CArena::
+clear()
+{
+  for (auto &block : blocks_)
+    ::operator delete(block.data);
+
+  blocks_.clear();
+
+  reset();
+}
+
+std::size_t
+CArena::
+memUsage() const
+{
+  std::size_t n = 0;
+
+  for (const auto &block : blocks_)
+    n += block.size;
+
+  return n;
+}
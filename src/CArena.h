@@ -0,0 +1,68 @@
+#ifndef CArena_H
+#define CArena_H
+
+#include <memory_resource>
+#include <vector>
+#include <cstddef>
+
+// Monotonic memory arena.
+//
+// Allocation bumps an offset in the current block and deallocation does nothing. Block
+// size doubles up to a maximum so unused memory at the end of the arena stays small. Reset
+// rewinds to the first block and keeps all blocks, so repeatedly building and resetting
+// structures of similar size needs no heap allocation. Can be used as a polymorphic
+// memory resource for std::pmr containers. Not thread safe.
+class CArena : public std::pmr::memory_resource {
+ public:
+  static constexpr std::size_t MaxBlockSize = (1 << 20);
+
+ public:
+  CArena(std::size_t blockSize=(1 << 16));
+
+ ~CArena() override;
+
+  CArena(const CArena &) = delete;
+  CArena &operator=(const CArena &) = delete;
+
+  //! allocate bytes with specified alignment (power of two)
+  void *alloc(std::size_t bytes, std::size_t align=alignof(std::max_align_t));
+
+  //! rewind to start (all allocated memory is reused)
+  void reset();
+
+  //! free all blocks
+  void clear();
+
+  //! bytes allocated since reset
+  std::size_t used() const { return used_; }
+
+  //! bytes in blocks
+  std::size_t memUsage() const;
+
+ private:
+  void *do_allocate(std::size_t bytes, std::size_t align) override {
+    return alloc(bytes, align);
+  }
+
+  void do_deallocate(void *, std::size_t, std::size_t) override { }
+
+  bool do_is_equal(const std::pmr::memory_resource &rhs) const noexcept override {
+    return this == &rhs;
+  }
+
+ private:
+  struct Block {
+    char*       data { nullptr };
+    std::size_t size { 0 };
+  };
+
+  using Blocks = std::vector<Block>;
+
+  Blocks      blocks_;
+  std::size_t blockSize_ { 0 }; // size of first block
+  std::size_t block_     { 0 }; // current block
+  std::size_t pos_       { 0 }; // offset in current block
+  std::size_t used_      { 0 };
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include <CCircleAnim.h>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+void
+CCircleAnim::
+resize(std::size_t n)
+{
+  n_ = n;
+
+  starts_ .resize(NUM_CHANNELS*n_);
+  targets_.resize(NUM_CHANNELS*n_);
+  values_ .resize(NUM_CHANNELS*n_);
+}
+
+void
+CCircleAnim::
+setPos(float t)
+{
+  interpolate(starts_.data(), targets_.data(), values_.data(), values_.size(), t);
+}
+
+void
+CCircleAnim::
+interpolate(const float *starts, const float *targets, float *values, std::size_t n,
+            float t)
+{
+  std::size_t i = 0;
+
+  // separate multiply and add (no fma) so all paths give identical results
+#if defined(__AVX__)
+  auto t8 = _mm256_set1_ps(t);
+
+  for ( ; i + 8 <= n; i += 8) {
+    auto s = _mm256_loadu_ps(starts  + i);
+    auto e = _mm256_loadu_ps(targets + i);
+
+    _mm256_storeu_ps(values + i, _mm256_add_ps(s, _mm256_mul_ps(_mm256_sub_ps(e, s), t8)));
+  }
+#endif
+
+#if defined(__SSE2__)
+  auto t4 = _mm_set1_ps(t);
+
+  for ( ; i + 4 <= n; i += 4) {
+    auto s = _mm_loadu_ps(starts  + i);
+    auto e = _mm_loadu_ps(targets + i);
+
+    _mm_storeu_ps(values + i, _mm_add_ps(s, _mm_mul_ps(_mm_sub_ps(e, s), t4)));
+  }
+#endif
+
+  for ( ; i < n; ++i)
+    values[i] = starts[i] + (targets[i] - starts[i])*t;
+}
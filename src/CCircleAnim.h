@@ -0,0 +1,73 @@
+#ifndef CCircleAnim_H
+#define CCircleAnim_H
+
+#include <cstddef>
+#include <vector>
+
+// Animation state of circles stored as structure of arrays.
+//
+// Each circle has a start and target value for each channel (center, size, and pen and
+// brush color components in 0-255). Setting the animation position t in [0, 1] updates
+// all current values to the interpolated value. All channels of all circles are stored in
+// one contiguous array so this is a single vectorized (AVX/SSE2, scalar fallback) pass
+// over the data.
+class CCircleAnim {
+ public:
+  enum Channel {
+    XC,
+    YC,
+    WIDTH,
+    HEIGHT,
+    PEN_R,
+    PEN_G,
+    PEN_B,
+    PEN_A,
+    BRUSH_R,
+    BRUSH_G,
+    BRUSH_B,
+    BRUSH_A,
+    NUM_CHANNELS
+  };
+
+ public:
+  CCircleAnim() { }
+
+  //! number of circles
+  std::size_t size() const { return n_; }
+
+  //! resize for n circles (values are undefined)
+  void resize(std::size_t n);
+
+  void clear() { resize(0); }
+
+  //! current value of channel for circle i
+  float value(Channel c, std::size_t i) const { return values_[c*n_ + i]; }
+
+  //! start value of channel for circle i (also sets current value)
+  float start(Channel c, std::size_t i) const { return starts_[c*n_ + i]; }
+  void setStart(Channel c, std::size_t i, float v) {
+    starts_[c*n_ + i] = v;
+    values_[c*n_ + i] = v;
+  }
+
+  //! target value of channel for circle i
+  float target(Channel c, std::size_t i) const { return targets_[c*n_ + i]; }
+  void setTarget(Channel c, std::size_t i, float v) { targets_[c*n_ + i] = v; }
+
+  //! set current values to position t between starts and targets
+  void setPos(float t);
+
+  //! values[i] = starts[i] + (targets[i] - starts[i])*t for i in [0, n)
+  static void interpolate(const float *starts, const float *targets, float *values,
+                          std::size_t n, float t);
+
+ private:
+  using Values = std::vector<float>;
+
+  std::size_t n_ { 0 };
+  Values      starts_;
+  Values      targets_;
+  Values      values_;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef CCircleDrawSink_H
+#define CCircleDrawSink_H
+
+#include <array>
+#include <cstddef>
+
+namespace CCircleFactor {
+
+// draw circle (center, diameter and fraction of all circles in id order)
+struct DrawRecord {
+  double x    { 0.0 };
+  double y    { 0.0 };
+  double size { 0.0 };
+  double f    { 0.0 };
+};
+
+// Streaming sink for generated draw circles.
+//
+// Circles are buffered into fixed size chunks and each full chunk is passed to a plain
+// (non-virtual) callback, so consumers can write or rasterize circles as they are
+// generated with memory bounded by the chunk size. The last partial chunk is passed by
+// flush (called at end of CircleMgr::generate).
+class DrawSink {
+ public:
+  static constexpr std::size_t ChunkSize = 4096;
+
+  using ChunkProc = void (*)(void *data, const DrawRecord *records, std::size_t n);
+
+ public:
+  DrawSink(ChunkProc proc, void *data) :
+   proc_(proc), data_(data) {
+  }
+
+  //! sink calling obj->drawChunk(records, n)
+  template<typename T>
+  static DrawSink make(T *obj) {
+    return DrawSink([](void *data, const DrawRecord *records, std::size_t n) {
+      static_cast<T *>(data)->drawChunk(records, n);
+    }, obj);
+  }
+
+  void add(double x, double y, double size, double f) {
+    auto &record = records_[n_];
+
+    record.x    = x;
+    record.y    = y;
+    record.size = size;
+    record.f    = f;
+
+    if (++n_ == ChunkSize)
+      flush();
+  }
+
+  void flush() {
+    if (n_ > 0) {
+      proc_(data_, records_.data(), n_);
+
+      n_ = 0;
+    }
+  }
+
+ private:
+  using Records = std::array<DrawRecord, ChunkSize>;
+
+  ChunkProc   proc_ { nullptr };
+  void*       data_ { nullptr };
+  Records     records_;
+  std::size_t n_    { 0 };
+};
+
+}
+
+#endif
@@ -1,16 +1,59 @@
 #include <CCircleFactor.h>
-#include <CPrime.h>
+#include <CClosestPair.h>
 
 #include <cmath>
 #include <cassert>
 
 namespace CCircleFactor {
 
+namespace {
+
+// squared closest distance between points (or maxD2 if smaller)
+double closestDistSqr(const Points &points, double maxD2) {
+  auto np = points.size();
+
+  std::vector<double> x(np), y(np);
+
+  for (std::size_t i = 0; i < np; ++i) {
+    x[i] = points[i].x;
+    y[i] = points[i].y;
+  }
+
+  return CClosestPair::closestDistSqr(x.data(), y.data(), np, maxD2);
+}
+
+// squared closest distance between points in range [i1, i2) of point arrays
+double closestDistSqr(const PointArrays &points, std::size_t i1, std::size_t i2,
+                      double maxD2) {
+  return CClosestPair::closestDistSqr(&points.x[i1], &points.y[i1], i2 - i1, maxD2);
+}
+
+}
+
 //---
 
 CircleMgr::
 CircleMgr()
 {
+  instanceTree_.setCancelProc([this]() { return isCancelled(); });
+}
+
+CircleMgr::
+~CircleMgr()
+{
+  reset();
+}
+
+void
+CircleMgr::
+setNumThreads(std::size_t n)
+{
+  if (n == numThreads_)
+    return;
+
+  numThreads_ = n;
+
+  workPool_.reset();
 }
 
 void
@@ -24,9 +67,25 @@ void
 CircleMgr::
 reset()
 {
-  delete circle_;
+  // destroy circles and rewind arena to reuse memory
+  for (auto *circle = circleList_; circle; ) {
+    auto *next = circle->next_;
+
+    circle->~Circle();
+
+    circle = next;
+  }
 
-  circle_ = nullptr;
+  circleList_ = nullptr;
+  circle_     = nullptr;
+
+  arena_.reset();
+
+  pointArrays_.clear();
+
+  instanceTree_.clear();
+
+  instanced_ = false;
 }
 
 void
@@ -37,17 +96,43 @@ calc()
 
   reset();
 
-  factors_ = CPrime::factors(factor_);
+  auto entry = factorCache_.lookup(factor_);
+
+  factors_ = entry.factors;
+
+  // large values use instanced tree (no circle or point objects)
+  if (instanceThreshold_ > 0 && std::size_t(factor_) >= instanceThreshold_) {
+    instanced_ = true;
+
+    incLastId(std::size_t(factor_));
+
+    instanceTree_.calc(factors_);
+
+    setS(instanceTree_.s(), instanceTree_.maxS());
+
+    return;
+  }
+
+  pointArrays_.reserve(std::size_t(factor_));
+
+  if (numThreads_ != 1 && ! workPool_)
+    workPool_ = std::make_unique<CWorkPool>(numThreads_);
 
   circle_ = makeCircle();
 
-  if (CPrime::isPrime(factor_))
+  if (entry.prime)
     calcPrime(circle_, factor_);
   else
-    calcFactors(circle_, factors_);
+    calcFactors(circle_, factors_, 0);
+
+  if (isCancelled())
+    return;
 
   circle_->place();
 
+  if (isCancelled())
+    return;
+
   circle_->fit();
 }
 
@@ -55,46 +140,82 @@ void
 CircleMgr::
 generate(double w, double h)
 {
+  if (! instanced_ && ! circle_)
+    return;
+
   // position in unit circle, centered at 0.5, 0.5
-  double xc = circle_->xc();
-  double yc = circle_->yc();
+  double xc = (instanced_ ? instanceTree_.xc() : circle_->xc());
+  double yc = (instanced_ ? instanceTree_.yc() : circle_->yc());
 
   pos_  = Point(center_.x + (xc - 0.5)*w, center_.y + (0.5 - yc)*h);
   size_ = std::min(w, h);
 
-  circle_->generate(pos_, size_);
+  if (instanced_)
+    generateInstanced();
+  else
+    circle_->generate(pos_, size_);
+
+  if (drawSink_)
+    drawSink_->flush();
+}
+
+void
+CircleMgr::
+generateInstanced()
+{
+  // see Circle::generate (only point circles are drawn)
+  static double ps = 8;
+
+  double size1 = size_/maxS();
+
+  double s = 0.9*this->s()*size1;
+
+  for (auto p = instanceTree_.points(); p.isValid(); p.next()) {
+    if ((p.index() & 0xFFFF) == 0 && isCancelled())
+      break;
+
+    double x = (p.x() - 0.5)*size1 + pos_.x;
+    double y = (p.y() - 0.5)*size1 + pos_.y;
+
+    auto f = double(p.index())/double(lastId());
+
+    drawCircle(x, y, s, f);
+
+    if (isDebug())
+      addDebugCircle(x, y, ps, 0.0, 1.0);
+  }
 }
 
 void
 CircleMgr::
-calcFactors(Circle *circle, const Factors &f)
+calcFactors(Circle *circle, const Factors &f, std::size_t i)
 {
-  if (f.size() == 1) {
-    calcPrime(circle, f[0]);
+  if (i == f.size() - 1) {
+    calcPrime(circle, f[i]);
     return;
   }
 
   //------
 
-  // split into first factor and list of remaining factors
-  auto pf = f.begin();
-
-  auto n1 = *pf++;
+  // split into first factor and remaining factors (from i + 1)
+  auto n1 = f[i];
 
-  Factors f1;
+  //------
 
-  std::copy(pf, f.end(), std::back_inserter(f1));
+  // add n circles (child points are added depth first so are contiguous)
+  circle->pointsBegin_ = pointArrays_.size();
 
-  //------
+  circle->circles_.reserve(size_t(n1));
 
-  // add n circles
-  for (int i = 0; i < n1; ++i) {
-    auto *circle1 = makeCircle(circle, size_t(i));
+  for (int j = 0; j < n1; ++j) {
+    auto *circle1 = makeCircle(circle, size_t(j));
 
     circle->addCircle(circle1);
 
-    calcFactors(circle1, f1);
+    calcFactors(circle1, f, i + 1);
   }
+
+  circle->pointsEnd_ = pointArrays_.size();
 }
 
 void
@@ -115,35 +236,34 @@ Circle *
 CircleMgr::
 makeCircle()
 {
-  return new Circle(this);
+  return newCircle<Circle>(this);
 }
 
 Circle *
 CircleMgr::
 makeCircle(Circle *parent, std::size_t n)
 {
-  return new Circle(parent, n);
+  return newCircle<Circle>(parent, n);
 }
 
 //------
 
 Circle::
 Circle(CircleMgr *mgr) :
- mgr_(mgr)
+ mgr_(mgr), circles_(&mgr->arena())
 {
 }
 
 Circle::
 Circle(Circle *parent, std::size_t n) :
- mgr_(parent->mgr()), parent_(parent), n_(n)
+ mgr_(parent->mgr()), parent_(parent), n_(n), circles_(&mgr_->arena())
 {
 }
 
+// child circles are owned by manager
 Circle::
 ~Circle()
 {
-  for (auto &circle : circles_)
-    delete circle;
 }
 
 void
@@ -166,69 +286,184 @@ void
 Circle::
 addPoint()
 {
-  points_.emplace_back(0.0, 0.0);
+  auto &points = mgr_->pointArrays();
+
+  // leaf points are consecutive so first point index is unique owner id
+  if (numPoints_ == 0)
+    pointsBegin_ = points.size();
+
+  points.add(0.0, 0.0, uint32_t(pointsBegin_));
+
+  ++numPoints_;
+
+  pointsEnd_ = points.size();
 }
 
 void
 Circle::
 place()
 {
+  if (mgr_->isCancelled())
+    return;
+
   if (! circles_.empty()) {
     auto nc = circles_.size();
 
     double da = 2.0*M_PI/double(nc);
 
-    // place child circles
+    // place child circles (2x2 case rotates children by 90 degrees)
+    bool rotate = (size() == 2 && circles_[0]->size() == 2);
+
+    std::vector<double> angles(nc);
+
     double a = a_;
 
-    for (auto &circle : circles_) {
-      if (size() == 2 && circle->size() == 2)
-        circle->setA(a + M_PI/2.0);
-      else
-        circle->setA(a);
+    for (std::size_t i = 0; i < nc; ++i) {
+      angles[i] = a;
 
-      circle->place();
+      if (rotate)
+        circles_[i]->setA(a + M_PI/2.0);
+      else
+        circles_[i]->setA(a);
 
       a += da;
     }
 
-    // find minimum point distance for child circles
-    double d = 1E50;
+    // all children have the same factors so when layout is memoized only the first child
+    // is placed and the others are copies of it rotated to their start angle
+    if (mgr_->isMemoLayout()) {
+      circles_[0]->place();
 
-    for (auto &circle : circles_) {
-      d = std::min(d, circle->closestPointDistance());
+      forEachChild([&](std::size_t i) {
+        if (i > 0)
+          circles_[i]->copyLayout(circles_[0], angles[i] - a_);
+      });
+    }
+    else {
+      forEachChild([&](std::size_t i) {
+        circles_[i]->place();
+      });
     }
-
-    double rr = d/2.0;
 
     // place in circle (center (0.5, 0.5), radius 0.5)
     c_ = Point(0.5, 0.5);
     r_ = 0.5;
 
-    for (;;) {
-      a = a_;
+    auto moveCircles = [&]() {
+      forEachChild([&](std::size_t i) {
+        double x1 = x() + r_*std::cos(angles[i]);
+        double y1 = y() + r_*std::sin(angles[i]);
 
-      for (auto &circle : circles_) {
-        double x1 = x() + r_*std::cos(a);
-        double y1 = y() + r_*std::sin(a);
+        circles_[i]->move(x1, y1);
+      });
+    };
 
-        circle->move(x1, y1);
+    // child bounding radius
+    double b = 0.0;
 
-        a += da;
-      }
+    for (auto &circle : circles_)
+      b = std::max(b, circle->boundRadius());
 
-      double r1 = closestCircleCircleDistance()/2;
+    if (mgr_->placeMode() == CircleMgr::PlaceMode::ANALYTIC) {
+      // minimum point distance for child circles
+      double d = 1E25;
 
-      double dr = fabs(r1 - rr);
+      for (auto &circle : circles_)
+        d = std::min(d, circle->pointDist());
 
-      if (dr < 1E-3)
-        break;
+      // Adjacent children are separated by the line bisecting the angle between them. For
+      // radius r each child center is r*sin(da/2) from this line, so the gap along the chord
+      // (2*r*sin(da/2)) is reduced by how far each child's points extend towards the line.
+      // Using the extent of the points rather than the bounding radius keeps the gap close
+      // to the child point distance without searching. Extents are measured from the actual
+      // child points so this also handles rotated children (2x2 case).
+      if (nc > 1) {
+        double s = std::sin(da/2.0);
+        double c = std::cos(da/2.0);
 
-      if (r1 < rr)
-        r_ += dr/2;
+        std::vector<double> nextExtent(nc), prevExtent(nc);
+
+        const auto &points = mgr_->pointArrays();
+
+        forEachChild([&](std::size_t i) {
+          auto *circle = circles_[i];
+
+          double ca = std::cos(angles[i]), sa = std::sin(angles[i]);
+
+          double e1 = 0.0, e2 = 0.0;
+
+          for (auto j = circle->pointsBegin(); j < circle->pointsEnd(); ++j) {
+            // offset from child center in radial (u) and tangential (v) directions
+            double dx = points.x[j] - 0.5, dy = points.y[j] - 0.5;
+
+            double u =  dx*ca + dy*sa;
+            double v = -dx*sa + dy*ca;
+
+            e1 = std::max(e1, v*c - u*s); // towards next child
+            e2 = std::max(e2, -v*c - u*s); // towards previous child
+          }
+
+          nextExtent[i] = e1;
+          prevExtent[i] = e2;
+        });
+
+        double r = 0.0;
+
+        for (std::size_t i = 0; i < nc; ++i) {
+          auto j = (i + 1) % nc;
+
+          r = std::max(r, (d + nextExtent[i] + prevExtent[j])/(2.0*s));
+        }
+
+        r_ = r;
+      }
       else
-        r_ -= dr/2;
+        r_ = 0.0;
+
+      moveCircles();
+
+      pointDist_ = d;
     }
+    else {
+      // find minimum point distance for child circles
+      double d = 1E50;
+
+      std::vector<double> dists(nc);
+
+      forEachChild([&](std::size_t i) {
+        dists[i] = circles_[i]->closestPointDistance();
+      });
+
+      for (auto d1 : dists)
+        d = std::min(d, d1);
+
+      double rr = d/2.0;
+
+      double r1 = rr;
+
+      for (;;) {
+        if (mgr_->isCancelled())
+          return;
+
+        moveCircles();
+
+        r1 = closestCircleCircleDistance()/2;
+
+        double dr = fabs(r1 - rr);
+
+        if (dr < 1E-3)
+          break;
+
+        if (r1 < rr)
+          r_ += dr/2;
+        else
+          r_ -= dr/2;
+      }
+
+      pointDist_ = std::min(d, 2*r1);
+    }
+
+    boundRadius_ = r_ + b;
   }
   else {
     auto np = numPoints();
@@ -249,9 +484,15 @@ place()
 
         a += da;
       }
+
+      pointDist_   = 2.0*r_*std::sin(M_PI/double(np));
+      boundRadius_ = r_;
     }
     else {
       setPoint(0, Point(0.0, 0.0));
+
+      pointDist_   = 1E25;
+      boundRadius_ = 0.0;
     }
   }
 }
@@ -276,13 +517,10 @@ void
 Circle::
 fit()
 {
-  // get all points
-  Points points;
-
-  getPoints(points);
+  const auto &points = mgr_->pointArrays();
 
   // calc closest centers and range
-  auto np = points.size();
+  auto np = pointsEnd_ - pointsBegin_;
 
   double xmin = 0.5;
   double ymin = 0.5;
@@ -291,27 +529,20 @@ fit()
 
   double d = 2;
 
-  for (std::size_t i = 0; i < np; ++i) {
-    const Point &p1 = points[i];
+  // closest distance is known from analytic placement
+  bool analytic = (mgr_->placeMode() == CircleMgr::PlaceMode::ANALYTIC);
 
-    for (std::size_t j = i + 1; j < np; ++j) {
-      assert(i != j);
+  if (analytic)
+    d = std::min(d, pointDist_*pointDist_);
 
-      const Point &p2 = points[j];
+  if (! analytic)
+    d = closestDistSqr(points, pointsBegin_, pointsEnd_, d);
 
-      double dx = p1.x - p2.x;
-      double dy = p1.y - p2.y;
-
-      double d1 = dx*dx + dy*dy;
-
-      if (d1 < d)
-        d = d1;
-    }
-
-    xmin = std::min(xmin, p1.x);
-    ymin = std::min(ymin, p1.y);
-    xmax = std::max(xmax, p1.x);
-    ymax = std::max(ymax, p1.y);
+  for (auto i = pointsBegin_; i < pointsEnd_; ++i) {
+    xmin = std::min(xmin, points.x[i]);
+    ymin = std::min(ymin, points.y[i]);
+    xmax = std::max(xmax, points.x[i]);
+    ymax = std::max(ymax, points.y[i]);
   }
 
   //---
@@ -348,33 +579,13 @@ double
 Circle::
 closestCircleCircleDistance() const
 {
-  // get all points
-  CirclePoints points;
+  const auto &points = mgr_->pointArrays();
 
-  getCirclePoints(points);
-
-  // calc closest centers and range
-  auto np = points.size();
+  // calc closest points from different circles
+  auto i1 = pointsBegin_;
 
-  double d = 1E50;
-
-  for (std::size_t i = 0; i < np; ++i) {
-    const CirclePoint &p1 = points[i];
-
-    for (std::size_t j = i + 1; j < np; ++j) {
-      const CirclePoint &p2 = points[j];
-
-      if (p1.circle == p2.circle) continue;
-
-      double dx = p1.point.x - p2.point.x;
-      double dy = p1.point.y - p2.point.y;
-
-      double d1 = dx*dx + dy*dy;
-
-      if (d1 < d)
-        d = d1;
-    }
-  }
+  double d = CClosestPair::closestDistSqr(&points.x[i1], &points.y[i1], &points.owner[i1],
+                                          pointsEnd_ - i1, 1E50);
 
   return sqrt(d);
 }
@@ -383,90 +594,33 @@ double
 Circle::
 closestPointDistance() const
 {
-  // get all points
-  Points points;
-
-  getPoints(points);
-
-  // calc closest centers and range
-  auto np = points.size();
-
-  double d = 1E50;
-
-  for (std::size_t i = 0; i < np; ++i) {
-    const Point &p1 = points[i];
-
-    for (std::size_t j = i + 1; j < np; ++j) {
-      assert(i != j);
-
-      const Point &p2 = points[j];
-
-      double dx = p1.x - p2.x;
-      double dy = p1.y - p2.y;
-
-      double d1 = dx*dx + dy*dy;
-
-      if (d1 < d)
-        d = d1;
-    }
-  }
-
-  return sqrt(d);
+  // calc closest points
+  return sqrt(closestDistSqr(mgr_->pointArrays(), pointsBegin_, pointsEnd_, 1E50));
 }
 
 double
 Circle::
 closestSize() const
 {
-  double d = 1E50;
+  Points points;
 
   if (! circles_.empty()) {
-    auto nc = circles_.size();
-
-    for (std::size_t i = 0; i < nc; ++i) {
-      Circle *c1 = circles_[i];
-
-      Point p1 = c1->center();
-
-      for (std::size_t j = i + 1; j < nc; ++j) {
-        assert(i != j);
-
-        Circle *c2 = circles_[j];
-
-        Point p2 = c2->center();
-
-        double dx = p1.x - p2.x;
-        double dy = p1.y - p2.y;
-
-        double d1 = dx*dx + dy*dy;
-
-        if (d1 < d)
-          d = d1;
-      }
-    }
+    for (const auto &circle : circles_)
+      points.push_back(circle->center());
   }
   else {
-    auto np = points_.size();
+    // point offsets from center
+    auto np = numPoints();
 
     for (std::size_t i = 0; i < np; ++i) {
-      const Point &p1 = points_[i];
-
-      for (std::size_t j = i + 1; j < np; ++j) {
-        assert(i != j);
-
-        const Point &p2 = points_[j];
-
-        double dx = p1.x - p2.x;
-        double dy = p1.y - p2.y;
+      auto p = getPoint(int(i));
 
-        double d1 = dx*dx + dy*dy;
-
-        if (d1 < d)
-          d = d1;
-      }
+      points.emplace_back((p.x - x())/r_, (p.y - y())/r_);
     }
   }
 
+  double d = closestDistSqr(points, 1E50);
+
   d = sqrt(d);
 
   return d;
@@ -476,7 +630,7 @@ std::size_t
 Circle::
 size() const
 {
-  return std::max(circles_.size(), points_.size());
+  return std::max(circles_.size(), numPoints_);
 }
 
 Point
@@ -490,13 +644,10 @@ void
 Circle::
 getPoints(Points &points) const
 {
-  for (auto &circle : circles_)
-    circle->getPoints(points);
+  const auto &points1 = mgr_->pointArrays();
 
-  auto np = numPoints();
-
-  for (std::size_t i = 0; i < np; ++i)
-    points.push_back(getPoint(int(i)));
+  for (auto i = pointsBegin_; i < pointsEnd_; ++i)
+    points.emplace_back(points1.x[i], points1.y[i]);
 }
 
 void
@@ -516,7 +667,24 @@ Point
 Circle::
 getPoint(int i) const
 {
-  return Point(x() + r_*points_[size_t(i)].x, y() + r_*points_[size_t(i)].y);
+  const auto &points = mgr_->pointArrays();
+
+  auto j = pointsBegin_ + size_t(i);
+
+  return Point(points.x[j], points.y[j]);
+}
+
+void
+Circle::
+setPoint(int i, const Point &p)
+{
+  // store world position for offset from center (0-1)
+  auto &points = mgr_->pointArrays();
+
+  auto j = pointsBegin_ + size_t(i);
+
+  points.x[j] = x() + r_*p.x;
+  points.y[j] = y() + r_*p.y;
 }
 
 void
@@ -532,11 +700,90 @@ move(double x, double y)
 void
 Circle::
 moveBy(double dx, double dy)
+{
+  moveCentersBy(dx, dy);
+
+  // all points in tree are a single range
+  auto &points = mgr_->pointArrays();
+
+  for (auto i = pointsBegin_; i < pointsEnd_; ++i) {
+    points.x[i] += dx;
+    points.y[i] += dy;
+  }
+}
+
+void
+Circle::
+forEachChild(const std::function<void (std::size_t)> &proc) const
+{
+  auto nc = circles_.size();
+
+  // use thread pool when enough points to be worth splitting
+  auto *pool = mgr_->workPool();
+
+  if (pool && nc > 1 && pointsEnd_ - pointsBegin_ >= mgr_->parallelGrain())
+    pool->parallelFor(nc, proc);
+  else {
+    for (std::size_t i = 0; i < nc; ++i)
+      proc(i);
+  }
+}
+
+void
+Circle::
+copyLayout(const Circle *circle, double da)
+{
+  assert(pointsEnd_ - pointsBegin_ == circle->pointsEnd_ - circle->pointsBegin_);
+
+  double c = std::cos(da);
+  double s = std::sin(da);
+
+  copyCircleLayout(circle, da, c, s);
+
+  // rotate points about (0.5, 0.5)
+  auto &points = mgr_->pointArrays();
+
+  auto j = circle->pointsBegin_;
+
+  for (auto i = pointsBegin_; i < pointsEnd_; ++i, ++j) {
+    double dx = points.x[j] - 0.5;
+    double dy = points.y[j] - 0.5;
+
+    points.x[i] = 0.5 + dx*c - dy*s;
+    points.y[i] = 0.5 + dx*s + dy*c;
+  }
+}
+
+void
+Circle::
+copyCircleLayout(const Circle *circle, double da, double c, double s)
+{
+  assert(circles_.size() == circle->circles_.size());
+
+  double dx = circle->c_.x - 0.5;
+  double dy = circle->c_.y - 0.5;
+
+  c_ = Point(0.5 + dx*c - dy*s, 0.5 + dx*s + dy*c);
+
+  r_           = circle->r_;
+  a_           = circle->a_ + da;
+  pointDist_   = circle->pointDist_;
+  boundRadius_ = circle->boundRadius_;
+
+  auto nc = circles_.size();
+
+  for (std::size_t i = 0; i < nc; ++i)
+    circles_[i]->copyCircleLayout(circle->circles_[i], da, c, s);
+}
+
+void
+Circle::
+moveCentersBy(double dx, double dy)
 {
   c_ += Point(dx, dy);
 
   for (auto &circle : circles_)
-    circle->moveBy(dx, dy);
+    circle->moveCentersBy(dx, dy);
 }
 
 void
@@ -545,6 +792,9 @@ generate(const Point &pos, double size)
 {
   static double ps = 8;
 
+  if (mgr_->isCancelled())
+    return;
+
   double size1 = size/mgr()->maxS();
 
   if (! circles_.empty()) {
@@ -574,7 +824,7 @@ generate(const Point &pos, double size)
       // draw point circle
       auto f = double(id_ + i)/double(mgr_->lastId());
 
-      mgr_->addDrawCircle(x, y, s, f);
+      mgr_->drawCircle(x, y, s, f);
 
       // draw point
       if (mgr_->isDebug()) {
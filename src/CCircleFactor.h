@@ -1,6 +1,14 @@
 #ifndef CCircleFactor_H
 #define CCircleFactor_H
 
+#include <CArena.h>
+#include <CCircleDrawSink.h>
+#include <CCircleInstance.h>
+#include <CFactorCache.h>
+#include <CWorkPool.h>
+#include <functional>
+#include <memory>
+#include <memory_resource>
 #include <vector>
 #include <cmath>
 
@@ -11,7 +19,7 @@ namespace CCircleFactor {
 class CircleMgr;
 class Circle;
 
-using Circles = std::vector<Circle *>;
+using Circles = std::pmr::vector<Circle *>;
 
 //----
 
@@ -50,14 +58,54 @@ using CirclePoints = std::vector<CirclePoint>;
 
 //---
 
+// world space positions of all leaf points in a circle tree (structure of arrays).
+// Points are added depth first so the points of each circle are a contiguous range.
+struct PointArrays {
+  std::vector<double>   x;
+  std::vector<double>   y;
+  std::vector<uint32_t> owner; // owning (leaf) circle id
+
+  std::size_t size() const { return x.size(); }
+
+  void clear() {
+    x    .clear();
+    y    .clear();
+    owner.clear();
+  }
+
+  void reserve(std::size_t n) {
+    x    .reserve(n);
+    y    .reserve(n);
+    owner.reserve(n);
+  }
+
+  void add(double x1, double y1, uint32_t owner1) {
+    x    .push_back(x1);
+    y    .push_back(y1);
+    owner.push_back(owner1);
+  }
+};
+
+//---
+
 class CircleMgr {
  public:
-  using Factors = std::vector<int>;
+  using Factors = CPrimeFactors;
+
+  // how child circle ring radius is calculated:
+  //   ITERATIVE : search for radius where closest points of child circles match closest
+  //               points in child circles
+  //   ANALYTIC  : calculate radius from extent of child points along chord between
+  //               children (including 2x2 case where children are rotated)
+  enum class PlaceMode {
+    ITERATIVE,
+    ANALYTIC
+  };
 
  public:
   CircleMgr();
 
-  virtual ~CircleMgr() { }
+  virtual ~CircleMgr();
 
   //---
 
@@ -74,6 +122,14 @@ class CircleMgr {
 
   const Factors &factors() const { return factors_; }
 
+  CFactorCache &factorCache() { return factorCache_; }
+
+  const PointArrays &pointArrays() const { return pointArrays_; }
+  PointArrays &pointArrays() { return pointArrays_; }
+
+  //! arena used for circles (rewound by reset)
+  CArena &arena() { return arena_; }
+
   //---
 
   double s() const { return s_; }
@@ -91,6 +147,37 @@ class CircleMgr {
   bool isDebug() const { return debug_; }
   void setDebug(bool debug) { debug_ = debug; }
 
+  const PlaceMode &placeMode() const { return placeMode_; }
+  void setPlaceMode(const PlaceMode &m) { placeMode_ = m; }
+
+  // place first child only and copy (rotate) layout for other children
+  bool isMemoLayout() const { return memoLayout_; }
+  void setMemoLayout(bool b) { memoLayout_ = b; }
+
+  // values with at least this many points use an instanced tree (0 for never)
+  std::size_t instanceThreshold() const { return instanceThreshold_; }
+  void setInstanceThreshold(std::size_t n) { instanceThreshold_ = n; }
+
+  bool isInstanced() const { return instanced_; }
+
+  // threads used to place sibling circles (1 for serial, 0 for hardware concurrency).
+  // Results are identical to serial placement.
+  std::size_t numThreads() const { return numThreads_; }
+  void setNumThreads(std::size_t n);
+
+  // min points in circle to place its children in parallel
+  std::size_t parallelGrain() const { return parallelGrain_; }
+  void setParallelGrain(std::size_t n) { parallelGrain_ = n; }
+
+  // thread pool (null if serial, created by calc)
+  CWorkPool *workPool() const { return workPool_.get(); }
+
+  const InstanceTree &instanceTree() const { return instanceTree_; }
+
+  // streaming sink for draw circles (replaces addDrawCircle calls when set)
+  DrawSink *drawSink() const { return drawSink_; }
+  void setDrawSink(DrawSink *sink) { drawSink_ = sink; }
+
   //---
 
   void reset();
@@ -99,30 +186,65 @@ class CircleMgr {
 
   void generate(double w, double h);
 
-  Circle *makeCircle();
+  virtual Circle *makeCircle();
+
+  virtual Circle *makeCircle(Circle *parent, std::size_t n);
 
-  Circle *makeCircle(Circle *parent, std::size_t n);
+  // create circle (of Circle derived type) in arena, destroyed by reset
+  template<typename T, typename... Args>
+  T *newCircle(Args&&... args);
 
   //---
 
-  virtual void addDrawCircle(double xc, double yc, double size, double f) = 0;
+  // add draw circle to sink if set, otherwise to addDrawCircle
+  void drawCircle(double xc, double yc, double size, double f) {
+    if (drawSink_)
+      drawSink_->add(xc, yc, size, f);
+    else
+      addDrawCircle(xc, yc, size, f);
+  }
+
+  virtual void addDrawCircle(double /*xc*/, double /*yc*/, double /*size*/,
+                             double /*f*/) { }
 
   virtual void addDebugCircle(double /*xc*/, double /*yc*/, double /*size*/,
                               double /*strokeAlpha*/, double /*fillAlpha*/) { }
 
+  // polled during calc and generate (may be from pool threads), when true they stop early
+  // and leave incomplete results
+  virtual bool isCancelled() const { return false; }
+
  private:
-  void calcFactors(Circle *circle, const Factors &f);
+  void calcFactors(Circle *circle, const Factors &f, std::size_t i);
   void calcPrime  (Circle *circle, int n);
 
+  void generateInstanced();
+
  private:
-  int         factor_ { 1 };
-  Circle*     circle_ { nullptr };
-  Factors     factors_;
-  double      s_      { 1.0 };
-  double      maxS_   { 1.0 };
-  std::size_t lastId_ { 0 };
-  Point       center_ { 0.5, 0.5 };
-  bool        debug_  { false };
+  using WorkPoolP = std::unique_ptr<CWorkPool>;
+
+ private:
+  int          factor_            { 1 };
+  Circle*      circle_            { nullptr };
+  Factors      factors_;
+  CFactorCache factorCache_;                               // cached factors for interactive use
+  double       s_                 { 1.0 };
+  double       maxS_              { 1.0 };
+  std::size_t  lastId_            { 0 };
+  Point        center_            { 0.5, 0.5 };
+  bool         debug_             { false };
+  PlaceMode    placeMode_         { PlaceMode::ANALYTIC };
+  bool         memoLayout_        { true };
+  InstanceTree instanceTree_;                              // implicit tree for large values
+  std::size_t  instanceThreshold_ { 1 << 22 };
+  bool         instanced_         { false };
+  std::size_t  numThreads_        { 1 };
+  std::size_t  parallelGrain_     { 1 << 14 };
+  WorkPoolP    workPool_;                                  // pool for parallel placement
+  PointArrays  pointArrays_;                               // points of all circles
+  CArena       arena_;                                     // memory for circles
+  Circle*      circleList_        { nullptr };             // circles to destroy on reset
+  DrawSink*    drawSink_          { nullptr };             // streaming draw circle sink
 
   Point  pos_;
   double size_   { 1.0 };
@@ -139,7 +261,7 @@ class Circle {
   Circle(CircleMgr *mgr);
   Circle(Circle *parent, std::size_t n);
 
- ~Circle();
+  virtual ~Circle();
 
   CircleMgr *mgr() const { return mgr_; }
 
@@ -160,6 +282,9 @@ class Circle {
   double xc() const { return xc_; }
   double yc() const { return yc_; }
 
+  double pointDist() const { return pointDist_; }
+  double boundRadius() const { return boundRadius_; }
+
   void addCircle(Circle *circle);
 
   void addPoint();
@@ -187,29 +312,64 @@ class Circle {
 
   void getCirclePoints(CirclePoints &points) const;
 
-  std::size_t numPoints() const { return points_.size(); }
+  std::size_t numPoints() const { return numPoints_; }
+
+  // range of points (including child circle points) in manager point arrays
+  std::size_t pointsBegin() const { return pointsBegin_; }
+  std::size_t pointsEnd  () const { return pointsEnd_; }
 
   Point getPoint(int i) const;
-  void setPoint(int i, const Point &p) { points_[size_t(i)] = p; }
+  void setPoint(int i, const Point &p);
 
   void generate(const Point &pos, double size);
 
  private:
-  CircleMgr*  mgr_    { nullptr };   // manager
-  Circle*     parent_ { nullptr };   // parent circle (null if none)
-  std::size_t id_     { 0 };         // index (for color)
-  std::size_t n_      { 0 };         // index in parent
-  Point       c_;                    // center (0->1 (screen size))
-  double      r_      { 0.5 };       // radius
-  double      a_      { -M_PI/2.0 }; // angle
-  Points      points_;               // offset from center (0-1)
-  Circles     circles_;              // sub circles
-  double      xc_     { 0.0 };
-  double      yc_     { 0.0 };
+  void moveCentersBy(double dx, double dy);
+
+  // call proc for each child index (in parallel if large enough)
+  void forEachChild(const std::function<void (std::size_t)> &proc) const;
+
+  // copy placed layout of circle with same factors rotated by da about (0.5, 0.5)
+  void copyLayout(const Circle *circle, double da);
+
+  void copyCircleLayout(const Circle *circle, double da, double c, double s);
+
+ private:
+  CircleMgr*  mgr_         { nullptr };   // manager
+  Circle*     parent_      { nullptr };   // parent circle (null if none)
+  std::size_t id_          { 0 };         // index (for color)
+  std::size_t n_           { 0 };         // index in parent
+  Point       c_;                         // center (0->1 (screen size))
+  double      r_           { 0.5 };       // radius
+  double      a_           { -M_PI/2.0 }; // angle
+  std::size_t numPoints_   { 0 };         // number of (leaf) points
+  std::size_t pointsBegin_ { 0 };         // first point in manager arrays
+  std::size_t pointsEnd_   { 0 };         // end of points in manager arrays
+  Circles     circles_;                   // sub circles
+  Circle*     next_        { nullptr };   // next circle in manager destroy list
+  double      xc_          { 0.0 };
+  double      yc_          { 0.0 };
+  double      pointDist_   { 1E25 };      // closest point distance (set by place)
+  double      boundRadius_ { 0.0 };       // max point distance from center (set by place)
 };
 
 //---
 
+template<typename T, typename... Args>
+T *
+CircleMgr::
+newCircle(Args&&... args)
+{
+  auto *circle = new (arena_.alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+  circle->next_ = circleList_;
+  circleList_   = circle;
+
+  return circle;
+}
+
+//---
+
 }
 
 #endif
@@ -0,0 +1,292 @@
+#include <CCircleInstance.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace CCircleFactor {
+
+void
+InstanceTree::
+clear()
+{
+  levels_.clear();
+
+  numPoints_ = 0;
+}
+
+void
+InstanceTree::
+calc(const Factors &factors)
+{
+  clear();
+
+  auto nl = factors.size();
+
+  if (nl == 0)
+    return;
+
+  levels_.resize(nl);
+
+  numPoints_ = 1;
+
+  for (std::size_t k = 0; k < nl; ++k) {
+    auto &level = levels_[k];
+
+    level.n = std::size_t(factors[k]);
+
+    // child directions are calculated while iterating so memory does not depend on
+    // size of factor
+    level.da   = 2.0*M_PI/double(level.n);
+    level.step = level.dir(1);
+
+    // 2x2 case rotates children by 90 degrees
+    if (k + 1 < nl && level.n == 2 && factors[k + 1] == 2)
+      level.childDir = Dir(0.0, 1.0);
+
+    numPoints_ *= level.n;
+  }
+
+  place();
+
+  fit();
+}
+
+bool
+InstanceTree::
+isCancelled(const PointIterator &p) const
+{
+  // only check every 64K points
+  return (cancelProc_ && (p.index() & 0xFFFF) == 0 && cancelProc_());
+}
+
+double
+InstanceTree::
+pointDist() const
+{
+  return (! levels_.empty() ? levels_[0].pointDist : 1E25);
+}
+
+double
+InstanceTree::
+boundRadius() const
+{
+  return (! levels_.empty() ? levels_[0].boundRadius : 0.0);
+}
+
+InstanceTree::PointIterator
+InstanceTree::
+points() const
+{
+  double a = -M_PI/2.0;
+
+  return PointIterator(*this, 0, 0.5, 0.5, Dir(std::cos(a), std::sin(a)));
+}
+
+void
+InstanceTree::
+place()
+{
+  auto nl = levels_.size();
+
+  // leaf points on circle of radius 0.5
+  auto &leaf = levels_[nl - 1];
+
+  if (leaf.n > 1) {
+    leaf.r         = 0.5;
+    leaf.pointDist = 2.0*leaf.r*std::sin(M_PI/double(leaf.n));
+  }
+  else {
+    leaf.r         = 0.0;
+    leaf.pointDist = 1E25;
+  }
+
+  leaf.boundRadius = leaf.r;
+
+  // place levels bottom up (see Circle::place analytic mode). All children are rotated
+  // copies so extents of the first child (at angle zero) apply to all of them.
+  for (std::size_t k = nl - 1; k-- > 0; ) {
+    auto &level = levels_[k];
+
+    const auto &child = levels_[k + 1];
+
+    double d = child.pointDist;
+
+    if (level.n > 1) {
+      double da = 2.0*M_PI/double(level.n);
+
+      double s = std::sin(da/2.0);
+      double c = std::cos(da/2.0);
+
+      double e1 = 0.0, e2 = 0.0;
+
+      for (PointIterator p(*this, k + 1, 0.0, 0.0, level.childDir); p.isValid(); p.next()) {
+        if (isCancelled(p))
+          return;
+
+        // offset from child center in radial (u) and tangential (v) directions
+        double u = p.x(), v = p.y();
+
+        e1 = std::max(e1, v*c - u*s); // towards next child
+        e2 = std::max(e2, -v*c - u*s); // towards previous child
+      }
+
+      level.r = (d + e1 + e2)/(2.0*s);
+    }
+    else
+      level.r = 0.0;
+
+    level.pointDist   = d;
+    level.boundRadius = level.r + child.boundRadius;
+  }
+}
+
+void
+InstanceTree::
+fit()
+{
+  // see Circle::fit
+  double xmin = 0.5;
+  double ymin = 0.5;
+  double xmax = xmin;
+  double ymax = ymin;
+
+  double d = std::min(2.0, pointDist()*pointDist());
+
+  for (auto p = points(); p.isValid(); p.next()) {
+    if (isCancelled(p))
+      return;
+
+    xmin = std::min(xmin, p.x());
+    ymin = std::min(ymin, p.y());
+    xmax = std::max(xmax, p.x());
+    ymax = std::max(ymax, p.y());
+  }
+
+  //---
+
+  // use closest center to defined size so points don't touch
+  double s = 0.0;
+
+  if (d > 1E-6)
+    s = std::sqrt(d);
+  else
+    s = 1.0/double(numPoints_);
+
+  xmin -= s/2.0;
+  ymin -= s/2.0;
+  xmax += s/2.0;
+  ymax += s/2.0;
+
+  double xs = xmax - xmin;
+  double ys = ymax - ymin;
+
+  s_    = s;
+  maxS_ = std::max(xs, ys);
+
+  xc_ = ((xmax + xmin)/2.0 - 0.5)/maxS_ + 0.5;
+  yc_ = ((ymax + ymin)/2.0 - 0.5)/maxS_ + 0.5;
+}
+
+//------
+
+InstanceTree::PointIterator::
+PointIterator(const InstanceTree &tree, std::size_t level, double xc, double yc,
+              const Dir &dir) :
+ tree_(&tree), level_(level)
+{
+  auto nl = tree_->levels_.size();
+
+  if (level_ >= nl) {
+    valid_ = false;
+    return;
+  }
+
+  states_.resize(nl - level_);
+
+  auto &state = states_[0];
+
+  state.xc  = xc;
+  state.yc  = yc;
+  state.dir = dir;
+
+  update(0);
+}
+
+void
+InstanceTree::PointIterator::
+next()
+{
+  if (! valid_)
+    return;
+
+  ++index_;
+
+  const auto &levels = tree_->levels_;
+
+  // increment child index of last level, carry to previous levels
+  auto k = states_.size() - 1;
+
+  for (;;) {
+    auto &state = states_[k];
+
+    const auto &level = levels[level_ + k];
+
+    if (++state.i < level.n) {
+      // rotate by step, recalc exactly every 64 children to limit rounding error
+      if ((state.i & 63) == 0)
+        state.rot = level.dir(state.i);
+      else
+        state.rot = state.rot*level.step;
+
+      break;
+    }
+
+    state.i   = 0;
+    state.rot = Dir();
+
+    if (k == 0) {
+      valid_ = false;
+      return;
+    }
+
+    --k;
+  }
+
+  update(k);
+}
+
+void
+InstanceTree::PointIterator::
+update(std::size_t k)
+{
+  // recalc circles below changed level
+  const auto &levels = tree_->levels_;
+
+  auto ns = states_.size();
+
+  for ( ; k + 1 < ns; ++k) {
+    const auto &level = levels[level_ + k];
+    const auto &state = states_[k];
+
+    auto dir = state.dir*state.rot;
+
+    auto &state1 = states_[k + 1];
+
+    state1.i   = 0;
+    state1.rot = Dir();
+    state1.xc  = state.xc + level.r*dir.c;
+    state1.yc  = state.yc + level.r*dir.s;
+    state1.dir = dir*level.childDir;
+  }
+
+  // point position
+  const auto &level = levels[level_ + ns - 1];
+  const auto &state = states_[ns - 1];
+
+  auto dir = state.dir*state.rot;
+
+  x_ = state.xc + level.r*dir.c;
+  y_ = state.yc + level.r*dir.s;
+}
+
+}
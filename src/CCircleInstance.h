@@ -0,0 +1,150 @@
+#ifndef CCircleInstance_H
+#define CCircleInstance_H
+
+#include <CPrimeFactors.h>
+#include <functional>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+
+namespace CCircleFactor {
+
+// Instanced (implicit) circle tree.
+//
+// All circles at the same depth have the same factors so are rotated copies of each other.
+// Each level stores one prototype circle (ring radius and child angle step) and leaf
+// positions are generated on demand by stepping through the child indices of each level,
+// so memory scales with the number of factors rather than the number of points or the
+// size of the largest factor.
+//
+// Levels are placed with the same analytic ring radius as the materialized tree
+// (PlaceMode::ANALYTIC) so positions match it.
+class InstanceTree {
+ public:
+  using Factors    = CPrimeFactors;
+  using CancelProc = std::function<bool ()>;
+
+  // complex unit vector (rotation)
+  struct Dir {
+    double c { 1.0 };
+    double s { 0.0 };
+
+    Dir() { }
+
+    Dir(double c, double s) :
+     c(c), s(s) {
+    }
+
+    friend Dir operator*(const Dir &lhs, const Dir &rhs) {
+      return Dir(lhs.c*rhs.c - lhs.s*rhs.s, lhs.c*rhs.s + lhs.s*rhs.c);
+    }
+  };
+
+  // iterates leaf points (depth first) of the tree from a level
+  class PointIterator {
+   public:
+    PointIterator(const InstanceTree &tree, std::size_t level, double xc, double yc,
+                  const Dir &dir);
+
+    bool isValid() const { return valid_; }
+
+    // index of point (depth first)
+    std::size_t index() const { return index_; }
+
+    double x() const { return x_; }
+    double y() const { return y_; }
+
+    void next();
+
+   private:
+    void update(std::size_t level);
+
+   private:
+    struct State {
+      std::size_t i  { 0 };   // child index
+      double      xc { 0.0 }; // circle center
+      double      yc { 0.0 };
+      Dir         dir;        // circle start angle
+      Dir         rot;        // direction of child i relative to start angle
+    };
+
+    using States = std::vector<State>;
+
+    const InstanceTree* tree_  { nullptr };
+    std::size_t         level_ { 0 };
+    States              states_;
+    std::size_t         index_ { 0 };
+    double              x_     { 0.0 };
+    double              y_     { 0.0 };
+    bool                valid_ { true };
+  };
+
+ public:
+  InstanceTree() { }
+
+  void clear();
+
+  // polled during calc, when it returns true calc stops early
+  void setCancelProc(const CancelProc &proc) { cancelProc_ = proc; }
+
+  // build and place levels for factors (largest first)
+  void calc(const Factors &factors);
+
+  std::size_t numLevels() const { return levels_.size(); }
+
+  std::size_t numPoints() const { return numPoints_; }
+
+  //! closest point distance
+  double pointDist() const;
+
+  //! max point distance from center
+  double boundRadius() const;
+
+  //! fit results (see Circle::fit)
+  double s   () const { return s_; }
+  double maxS() const { return maxS_; }
+  double xc  () const { return xc_; }
+  double yc  () const { return yc_; }
+
+  //! iterate all points of tree
+  PointIterator points() const;
+
+ private:
+  void place();
+
+  void fit();
+
+  bool isCancelled(const PointIterator &p) const;
+
+ private:
+  struct Level {
+    std::size_t n           { 0 };    // number of children (or points)
+    double      r           { 0.0 };  // ring radius
+    double      da          { 0.0 };  // angle between children
+    Dir         step;                 // rotation by da
+    Dir         childDir;             // extra child rotation (2x2 case)
+    double      pointDist   { 1E25 }; // closest point distance
+    double      boundRadius { 0.0 };  // max point distance from center
+
+    // direction of child i relative to start angle
+    Dir dir(std::size_t i) const {
+      double a = double(i)*da;
+
+      return Dir(std::cos(a), std::sin(a));
+    }
+  };
+
+  using Levels = std::vector<Level>;
+
+  Levels      levels_;
+  CancelProc  cancelProc_;
+  std::size_t numPoints_ { 0 };
+  double      s_         { 1.0 };
+  double      maxS_      { 1.0 };
+  double      xc_        { 0.5 };
+  double      yc_        { 0.5 };
+};
+
+}
+
+#endif
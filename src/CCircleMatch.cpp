@@ -0,0 +1,307 @@
+#include <CCircleMatch.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+namespace {
+
+// k-d tree of unmatched points. Nodes hold contiguous ranges of point indices (median
+// split on widest side of bounding box) with count and bounding box of unmatched points,
+// so matched points are removed by updating the path to the root and searches skip
+// empty subtrees and prune on the tightened boxes.
+class KdTree {
+ public:
+  KdTree(const double *x, const double *y, std::size_t n) :
+   x_(x), y_(y) {
+    points_.resize(n);
+
+    for (std::size_t i = 0; i < n; ++i)
+      points_[i] = int(i);
+
+    nodes_.reserve(2*(n/LeafSize + 1));
+
+    if (n > 0)
+      build(-1, 0, uint32_t(n));
+
+    // coordinates in tree order for locality of leaf scans
+    px_.resize(n);
+    py_.resize(n);
+
+    for (std::size_t s = 0; s < n; ++s) {
+      px_[s] = x_[points_[s]];
+      py_[s] = y_[points_[s]];
+    }
+  }
+
+  std::size_t numAlive() const { return (nodes_.empty() ? 0 : nodes_[0].alive); }
+
+  // find and remove nearest point to (x, y), -1 if none
+  int takeNearest(double x, double y) {
+    if (numAlive() == 0)
+      return -1;
+
+    int    best     = -1;
+    double bestD2   = 1E100;
+    int    bestSlot = -1;
+    int    bestNode = -1;
+
+    // depth first, nearest child first
+    stack_.clear();
+
+    stack_.emplace_back(0, boxDist2(nodes_[0], x, y));
+
+    while (! stack_.empty()) {
+      auto ind = stack_.back().first;
+      auto d2  = stack_.back().second;
+
+      stack_.pop_back();
+
+      if (d2 >= bestD2)
+        continue;
+
+      const auto &node = nodes_[std::size_t(ind)];
+
+      if (node.left < 0) {
+        for (auto s = node.begin; s < node.end; ++s) {
+          if (points_[s] < 0)
+            continue;
+
+          double dx = px_[s] - x, dy = py_[s] - y;
+
+          double pd2 = dx*dx + dy*dy;
+
+          if (pd2 < bestD2) {
+            best     = points_[s];
+            bestD2   = pd2;
+            bestSlot = int(s);
+            bestNode = ind;
+          }
+        }
+
+        continue;
+      }
+
+      const auto &lnode = nodes_[std::size_t(node.left )];
+      const auto &rnode = nodes_[std::size_t(node.right)];
+
+      double ld2 = (lnode.alive > 0 ? boxDist2(lnode, x, y) : 1E100);
+      double rd2 = (rnode.alive > 0 ? boxDist2(rnode, x, y) : 1E100);
+
+      if (ld2 <= rd2) {
+        if (rd2 < bestD2) stack_.emplace_back(node.right, rd2);
+        if (ld2 < bestD2) stack_.emplace_back(node.left , ld2);
+      }
+      else {
+        if (ld2 < bestD2) stack_.emplace_back(node.left , ld2);
+        if (rd2 < bestD2) stack_.emplace_back(node.right, rd2);
+      }
+    }
+
+    if (best >= 0)
+      remove(std::size_t(bestSlot), bestNode);
+
+    return best;
+  }
+
+ private:
+  struct Node {
+    double   xmin   {  1E50 }; // bounding box of unmatched points
+    double   ymin   {  1E50 };
+    double   xmax   { -1E50 };
+    double   ymax   { -1E50 };
+    uint32_t begin  { 0 };     // range in points
+    uint32_t end    { 0 };
+    uint32_t alive  { 0 };     // number of unmatched points
+    int      left   { -1 };    // children (-1 for leaf)
+    int      right  { -1 };
+    int      parent { -1 };
+  };
+
+  static constexpr uint32_t LeafSize = 8;
+
+  int build(int parent, uint32_t begin, uint32_t end) {
+    int ind = int(nodes_.size());
+
+    nodes_.emplace_back();
+
+    {
+      auto &node = nodes_.back();
+
+      node.begin  = begin;
+      node.end    = end;
+      node.alive  = end - begin;
+      node.parent = parent;
+
+      for (auto s = begin; s < end; ++s)
+        addBox(node, x_[points_[s]], y_[points_[s]]);
+    }
+
+    if (end - begin <= LeafSize)
+      return ind;
+
+    const auto &node = nodes_[std::size_t(ind)];
+
+    bool splitX = (node.xmax - node.xmin >= node.ymax - node.ymin);
+
+    auto mid = begin + (end - begin)/2;
+
+    std::nth_element(points_.begin() + begin, points_.begin() + mid, points_.begin() + end,
+                     [&](int i, int j) {
+      return (splitX ? x_[i] < x_[j] : y_[i] < y_[j]);
+    });
+
+    int left  = build(ind, begin, mid);
+    int right = build(ind, mid  , end);
+
+    nodes_[std::size_t(ind)].left  = left;
+    nodes_[std::size_t(ind)].right = right;
+
+    return ind;
+  }
+
+  // remove point in slot of leaf node, update counts and boxes to root
+  void remove(std::size_t slot, int ind) {
+    points_[slot] = -1;
+
+    auto &leaf = nodes_[std::size_t(ind)];
+
+    --leaf.alive;
+
+    resetBox(leaf);
+
+    for (auto s = leaf.begin; s < leaf.end; ++s)
+      if (points_[s] >= 0)
+        addBox(leaf, px_[s], py_[s]);
+
+    for (ind = leaf.parent; ind >= 0; ind = nodes_[std::size_t(ind)].parent) {
+      auto &node = nodes_[std::size_t(ind)];
+
+      --node.alive;
+
+      resetBox(node);
+
+      for (auto c : { node.left, node.right }) {
+        const auto &child = nodes_[std::size_t(c)];
+
+        if (child.alive == 0)
+          continue;
+
+        node.xmin = std::min(node.xmin, child.xmin); node.xmax = std::max(node.xmax, child.xmax);
+        node.ymin = std::min(node.ymin, child.ymin); node.ymax = std::max(node.ymax, child.ymax);
+      }
+    }
+  }
+
+  static void addBox(Node &node, double x, double y) {
+    node.xmin = std::min(node.xmin, x); node.xmax = std::max(node.xmax, x);
+    node.ymin = std::min(node.ymin, y); node.ymax = std::max(node.ymax, y);
+  }
+
+  static void resetBox(Node &node) {
+    node.xmin = 1E50; node.xmax = -1E50;
+    node.ymin = 1E50; node.ymax = -1E50;
+  }
+
+  // squared distance from (x, y) to node box (0 if inside)
+  static double boxDist2(const Node &node, double x, double y) {
+    double dx = std::max(std::max(node.xmin - x, x - node.xmax), 0.0);
+    double dy = std::max(std::max(node.ymin - y, y - node.ymax), 0.0);
+
+    return dx*dx + dy*dy;
+  }
+
+ private:
+  using Nodes = std::vector<Node>;
+  using Stack = std::vector<std::pair<int, double>>;
+
+  const double*       x_ { nullptr };
+  const double*       y_ { nullptr };
+  std::vector<int>    points_;        // point indices by node (-1 if matched)
+  std::vector<double> px_;            // point coordinates by node
+  std::vector<double> py_;
+  Nodes               nodes_;
+  Stack               stack_;         // search stack (node, box distance)
+};
+
+}
+
+//---
+
+namespace CCircleMatch {
+
+Matches
+match(const double *x1, const double *y1, std::size_t n1,
+      const double *x2, const double *y2, std::size_t n2)
+{
+  Matches matches(n2, -1);
+
+  if (n1 == 0 || n2 == 0)
+    return matches;
+
+  KdTree tree(x1, y1, n1);
+
+  for (std::size_t i = 0; i < n2; ++i) {
+    if (tree.numAlive() == 0)
+      break;
+
+    matches[i] = tree.takeNearest(x2[i], y2[i]);
+  }
+
+  assert(n1*n2 > (1 << 20) || isGreedyNearest(x1, y1, n1, x2, y2, n2, matches));
+
+  return matches;
+}
+
+bool
+isGreedyNearest(const double *x1, const double *y1, std::size_t n1,
+                const double *x2, const double *y2, std::size_t n2,
+                const Matches &matches)
+{
+  if (matches.size() != n2)
+    return false;
+
+  std::vector<bool> used(n1, false);
+
+  for (std::size_t i = 0; i < n2; ++i) {
+    // nearest unused old point (any of equal distance)
+    double minD2 = -1.0;
+
+    for (std::size_t j = 0; j < n1; ++j) {
+      if (used[j])
+        continue;
+
+      double dx = x1[j] - x2[i], dy = y1[j] - y2[i];
+
+      double d2 = dx*dx + dy*dy;
+
+      if (minD2 < 0.0 || d2 < minD2)
+        minD2 = d2;
+    }
+
+    int j = matches[i];
+
+    if (j < 0) {
+      // only unmatched when all old points used
+      if (minD2 >= 0.0)
+        return false;
+
+      continue;
+    }
+
+    if (std::size_t(j) >= n1 || used[std::size_t(j)])
+      return false;
+
+    double dx = x1[j] - x2[i], dy = y1[j] - y2[i];
+
+    if (dx*dx + dy*dy != minD2)
+      return false;
+
+    used[std::size_t(j)] = true;
+  }
+
+  return true;
+}
+
+}
@@ -0,0 +1,30 @@
+#ifndef CCircleMatch_H
+#define CCircleMatch_H
+
+#include <cstddef>
+#include <vector>
+
+// Match new circles to old circles by proximity of centers.
+//
+// Greedy approximation of the assignment problem: each new point (in order) takes the
+// nearest unmatched old point. Old points are stored in a k-d tree which keeps the count
+// and bounding box of unmatched points in each node, so a matched point is removed in
+// O(log N) and searches skip empty subtrees and prune on the remaining points (O(log N)
+// per search when the nearest unmatched point is close, unlike a fixed grid which scans
+// empty cells once nearby points are matched).
+namespace CCircleMatch {
+  using Matches = std::vector<int>;
+
+  // for each new point (x2[i], y2[i]) index of matched old point (x1[j], y1[j]) or -1
+  // (each old point is matched at most once)
+  Matches match(const double *x1, const double *y1, std::size_t n1,
+                const double *x2, const double *y2, std::size_t n2);
+
+  // check each match is the nearest old point not matched by an earlier new point
+  // (brute force O(N^2), used to check match in debug builds for small inputs)
+  bool isGreedyNearest(const double *x1, const double *y1, std::size_t n1,
+                       const double *x2, const double *y2, std::size_t n2,
+                       const Matches &matches);
+}
+
+#endif
@@ -0,0 +1,280 @@
+#include <CClosestPair.h>
+#include <CDelaunay.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// hashed grid of points, cells hold linked lists of point indices
+class Grid {
+ public:
+  static constexpr uint32_t nil = uint32_t(-1);
+
+  Grid(const double *x, const double *y, std::size_t n) :
+   x_(x), y_(y) {
+    // power of two table with at least two slots per point
+    std::size_t size = 16;
+
+    while (size < 2*n)
+      size <<= 1;
+
+    keys_ .resize(size);
+    heads_.resize(size);
+    next_ .resize(n);
+
+    mask_ = size - 1;
+
+    for (std::size_t i = 0; i < n; ++i) {
+      xmin_ = std::min(xmin_, x[i]);
+      ymin_ = std::min(ymin_, y[i]);
+    }
+  }
+
+  void reset(double cellSize) {
+    std::fill(heads_.begin(), heads_.end(), nil);
+
+    scale_ = 1.0/cellSize;
+  }
+
+  int64_t cellX(uint32_t i) const { return int64_t((x_[i] - xmin_)*scale_); }
+  int64_t cellY(uint32_t i) const { return int64_t((y_[i] - ymin_)*scale_); }
+
+  void add(uint32_t i) {
+    auto slot = findSlot(cellX(i), cellY(i));
+
+    if (heads_[slot] == nil) {
+      keys_[slot].cx = cellX(i);
+      keys_[slot].cy = cellY(i);
+    }
+
+    next_ [i]    = heads_[slot];
+    heads_[slot] = i;
+  }
+
+  // first point in cell (nil if empty)
+  uint32_t head(int64_t cx, int64_t cy) const { return heads_[findSlot(cx, cy)]; }
+
+  uint32_t next(uint32_t i) const { return next_[i]; }
+
+ private:
+  struct Key {
+    int64_t cx { 0 };
+    int64_t cy { 0 };
+  };
+
+  // slot for cell (linear probing, empty slot if cell not present)
+  std::size_t findSlot(int64_t cx, int64_t cy) const {
+    auto h = std::size_t(uint64_t(cx)*0x9E3779B97F4A7C15ULL ^ uint64_t(cy)*0xC2B2AE3D27D4EB4FULL);
+
+    for (auto slot = (h ^ (h >> 29)) & mask_; ; slot = (slot + 1) & mask_) {
+      if (heads_[slot] == nil || (keys_[slot].cx == cx && keys_[slot].cy == cy))
+        return slot;
+    }
+  }
+
+ private:
+  const double*         x_     { nullptr };
+  const double*         y_     { nullptr };
+  double                xmin_  { 1E300 };
+  double                ymin_  { 1E300 };
+  double                scale_ { 1.0 };
+  std::vector<Key>      keys_;
+  std::vector<uint32_t> heads_;
+  std::vector<uint32_t> next_;
+  std::size_t           mask_  { 0 };
+};
+
+double
+distSqr(const double *x, const double *y, std::size_t i, std::size_t j)
+{
+  double dx = x[i] - x[j];
+  double dy = y[i] - y[j];
+
+  return dx*dx + dy*dy;
+}
+
+double
+bruteForce(const double *x, const double *y, const uint32_t *owner, std::size_t n,
+           double d)
+{
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = i + 1; j < n; ++j) {
+      if (owner && owner[i] == owner[j]) continue;
+
+      double d1 = distSqr(x, y, i, j);
+
+      if (d1 < d)
+        d = d1;
+    }
+  }
+
+  return d;
+}
+
+// grid search, returns false if more than maxVisits points are visited
+bool
+gridSearch(const double *x, const double *y, const uint32_t *owner, std::size_t n,
+           double maxD2, std::size_t maxVisits, double &d)
+{
+  // shuffle insertion order (fixed seed so run time is repeatable)
+  std::vector<uint32_t> order(n);
+
+  for (std::size_t i = 0; i < n; ++i)
+    order[i] = uint32_t(i);
+
+  uint64_t seed = 0x2545F4914F6CDD1DULL;
+
+  for (std::size_t i = n - 1; i > 0; --i) {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+
+    std::swap(order[i], order[seed % (i + 1)]);
+  }
+
+  // initial distance from first point to first point with different owner
+  std::size_t k = 1;
+
+  if (owner) {
+    while (k < n && owner[order[k]] == owner[order[0]])
+      ++k;
+
+    if (k == n) {
+      d = maxD2;
+      return true;
+    }
+
+    std::swap(order[1], order[k]);
+  }
+
+  d = std::min(distSqr(x, y, order[0], order[1]), maxD2);
+
+  if (d <= 0.0)
+    return true;
+
+  //---
+
+  Grid grid(x, y, n);
+
+  auto rebuild = [&](std::size_t m) {
+    grid.reset(std::sqrt(d));
+
+    for (std::size_t i = 0; i < m; ++i)
+      grid.add(order[i]);
+  };
+
+  rebuild(2);
+
+  std::size_t numVisits = 0;
+
+  for (std::size_t i = 2; i < n; ++i) {
+    auto p = order[i];
+
+    auto cx = grid.cellX(p);
+    auto cy = grid.cellY(p);
+
+    double d1 = d;
+
+    for (int64_t iy = cy - 1; iy <= cy + 1; ++iy) {
+      for (int64_t ix = cx - 1; ix <= cx + 1; ++ix) {
+        for (auto q = grid.head(ix, iy); q != Grid::nil; q = grid.next(q)) {
+          if (++numVisits > maxVisits)
+            return false;
+
+          if (owner && owner[p] == owner[q]) continue;
+
+          d1 = std::min(d1, distSqr(x, y, p, q));
+        }
+      }
+    }
+
+    if (d1 < d) {
+      d = d1;
+
+      if (d <= 0.0)
+        return true;
+
+      rebuild(i + 1);
+    }
+    else
+      grid.add(p);
+  }
+
+  return true;
+}
+
+// closest pair of different owners is an edge of the Delaunay triangulation (its
+// diameter circle can contain no other point as that point would be closer to one of
+// them and have a different owner to one of them)
+double
+delaunaySearch(const double *x, const double *y, const uint32_t *owner, std::size_t n,
+               double maxD2)
+{
+  CDelaunay::Inds inds(n);
+
+  for (std::size_t i = 0; i < n; ++i)
+    inds[i] = uint32_t(i);
+
+  CDelaunay::sortPoints(x, y, inds);
+
+  // remove duplicate points (zero distance if owners differ)
+  std::size_t m = 0;
+
+  for (auto p : inds) {
+    if (m > 0) {
+      auto q = inds[m - 1];
+
+      if (x[p] == x[q] && y[p] == y[q]) {
+        if (owner[p] != owner[q])
+          return std::min(distSqr(x, y, p, q), maxD2);
+
+        continue;
+      }
+    }
+
+    inds[m++] = p;
+  }
+
+  inds.resize(m);
+
+  double d = maxD2;
+
+  for (const auto &edge : CDelaunay::edges(x, y, inds)) {
+    if (owner[edge.first] == owner[edge.second]) continue;
+
+    d = std::min(d, distSqr(x, y, edge.first, edge.second));
+  }
+
+  return d;
+}
+
+}
+
+//---
+
+double
+CClosestPair::
+closestDistSqr(const double *x, const double *y, std::size_t n, double maxD2)
+{
+  return closestDistSqr(x, y, nullptr, n, maxD2);
+}
+
+double
+CClosestPair::
+closestDistSqr(const double *x, const double *y, const uint32_t *owner, std::size_t n,
+               double maxD2)
+{
+  if (n <= GridThreshold)
+    return bruteForce(x, y, owner, n, maxD2);
+
+  // grid search is fastest but only O(N) if few points of the same owner are visited,
+  // so limit visits to O(N) and then use Delaunay edges (O(N log N))
+  auto maxVisits = (owner ? GridVisitFactor*n : SIZE_MAX);
+
+  double d;
+
+  if (gridSearch(x, y, owner, n, maxD2, maxVisits, d))
+    return d;
+
+  return delaunaySearch(x, y, owner, n, maxD2);
+}
@@ -0,0 +1,37 @@
+#ifndef CClosestPair_H
+#define CClosestPair_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Closest pair of points.
+//
+// Small point sets use a brute force scan. Larger sets use the randomized incremental grid
+// algorithm (expected O(N)): points are added in a shuffled order to a hashed grid with
+// cell size equal to the closest distance so far, so only the 3x3 neighbouring cells need
+// checking, and the grid is rebuilt whenever the closest distance shrinks.
+//
+// With owners, only pairs of points with different owners are compared, but the cell size
+// is the closest distance between different owners so points of one owner can be much
+// denser than the grid and are visited and skipped (O(N^2) for dense owners close to
+// each other). So the grid search stops after GridVisitFactor*N point visits and the
+// closest pair is then found from the edges of the Delaunay triangulation (O(N log N)),
+// which always include the closest pair of points with different owners.
+//
+// Results are exactly those of the brute force scan (same squared distance expression).
+namespace CClosestPair {
+  // point count above which grid is used
+  constexpr std::size_t GridThreshold = 64;
+
+  // max grid point visits per point (with owners) before Delaunay search is used
+  constexpr std::size_t GridVisitFactor = 32;
+
+  // squared closest distance between n points (x[i], y[i]), or maxD2 if smaller
+  double closestDistSqr(const double *x, const double *y, std::size_t n, double maxD2);
+
+  // squared closest distance between points with different owners, or maxD2 if smaller
+  double closestDistSqr(const double *x, const double *y, const uint32_t *owner,
+                        std::size_t n, double maxD2);
+}
+
+#endif
@@ -0,0 +1,519 @@
+#include <CDelaunay.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// exact arithmetic on expansions (sums of non overlapping doubles in increasing order of
+// magnitude, Shewchuk), only used when floating point sign is uncertain
+using Expansion = std::vector<double>;
+
+void
+twoSum(double a, double b, double &x, double &y)
+{
+  x = a + b;
+
+  double bv = x - a;
+  double av = x - bv;
+
+  y = (a - av) + (b - bv);
+}
+
+void
+fastTwoSum(double a, double b, double &x, double &y)
+{
+  // |a| >= |b|
+  x = a + b;
+  y = b - (x - a);
+}
+
+void
+twoProduct(double a, double b, double &x, double &y)
+{
+  x = a*b;
+  y = std::fma(a, b, -x);
+}
+
+// e + b (zero components removed)
+Expansion
+grow(const Expansion &e, double b)
+{
+  Expansion h;
+
+  h.reserve(e.size() + 1);
+
+  double q = b;
+
+  for (auto ei : e) {
+    double q1, hh;
+
+    twoSum(q, ei, q1, hh);
+
+    if (hh != 0.0)
+      h.push_back(hh);
+
+    q = q1;
+  }
+
+  if (q != 0.0 || h.empty())
+    h.push_back(q);
+
+  return h;
+}
+
+// e + f
+Expansion
+sum(const Expansion &e, const Expansion &f)
+{
+  auto h = e;
+
+  for (auto fi : f)
+    h = grow(h, fi);
+
+  return h;
+}
+
+// e*b (zero components removed)
+Expansion
+scale(const Expansion &e, double b)
+{
+  Expansion h;
+
+  h.reserve(2*e.size());
+
+  double q, hh;
+
+  twoProduct(e[0], b, q, hh);
+
+  if (hh != 0.0)
+    h.push_back(hh);
+
+  for (std::size_t i = 1; i < e.size(); ++i) {
+    double p1, p0, s;
+
+    twoProduct(e[i], b, p1, p0);
+
+    twoSum(q, p0, s, hh);
+
+    if (hh != 0.0)
+      h.push_back(hh);
+
+    fastTwoSum(p1, s, q, hh);
+
+    if (hh != 0.0)
+      h.push_back(hh);
+  }
+
+  if (q != 0.0 || h.empty())
+    h.push_back(q);
+
+  return h;
+}
+
+// e*f
+Expansion
+product(const Expansion &e, const Expansion &f)
+{
+  Expansion h { 0.0 };
+
+  for (auto fi : f)
+    h = sum(h, scale(e, fi));
+
+  return h;
+}
+
+Expansion
+negate(Expansion e)
+{
+  for (auto &ei : e)
+    ei = -ei;
+
+  return e;
+}
+
+// a - b
+Expansion
+diff(double a, double b)
+{
+  double x, y;
+
+  twoSum(a, -b, x, y);
+
+  if (y == 0.0)
+    return Expansion { x };
+
+  return Expansion { y, x };
+}
+
+// sign of most significant component
+int
+sign(const Expansion &e)
+{
+  double d = e.back();
+
+  return (d > 0.0 ? 1 : (d < 0.0 ? -1 : 0));
+}
+
+//---
+
+// error bounds (Shewchuk) of floating point determinants with relative error eps
+template<typename T>
+constexpr T ccwErrBound(T eps) { return (T(3.0) + T(16.0)*eps)*eps; }
+
+template<typename T>
+constexpr T iccErrBound(T eps) { return (T(10.0) + T(96.0)*eps)*eps; }
+
+// sign of orientation determinant in type T, 0 if uncertain
+template<typename T>
+int
+orientSign(T ax, T ay, T bx, T by, T cx, T cy, T eps)
+{
+  T detLeft  = (ax - cx)*(by - cy);
+  T detRight = (ay - cy)*(bx - cx);
+
+  T det = detLeft - detRight;
+
+  T errBound = ccwErrBound(eps)*(std::fabs(detLeft) + std::fabs(detRight));
+
+  if (det > errBound || -det > errBound)
+    return (det > 0 ? 1 : -1);
+
+  return 0;
+}
+
+// sign of in circle determinant in type T, 0 if uncertain
+template<typename T>
+int
+inCircleSign(T ax, T ay, T bx, T by, T cx, T cy, T dx, T dy, T eps)
+{
+  T adx = ax - dx, ady = ay - dy;
+  T bdx = bx - dx, bdy = by - dy;
+  T cdx = cx - dx, cdy = cy - dy;
+
+  T bdxcdy = bdx*cdy, cdxbdy = cdx*bdy;
+  T cdxady = cdx*ady, adxcdy = adx*cdy;
+  T adxbdy = adx*bdy, bdxady = bdx*ady;
+
+  T alift = adx*adx + ady*ady;
+  T blift = bdx*bdx + bdy*bdy;
+  T clift = cdx*cdx + cdy*cdy;
+
+  T det = alift*(bdxcdy - cdxbdy) + blift*(cdxady - adxcdy) + clift*(adxbdy - bdxady);
+
+  T permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy))*alift +
+                (std::fabs(cdxady) + std::fabs(adxcdy))*blift +
+                (std::fabs(adxbdy) + std::fabs(bdxady))*clift;
+
+  T errBound = iccErrBound(eps)*permanent;
+
+  if (det > errBound || -det > errBound)
+    return (det > 0 ? 1 : -1);
+
+  return 0;
+}
+
+// sign of orientation of triangle abc (positive if counter clockwise). Tries double then
+// long double (if more precise) then exact arithmetic.
+int
+orient(double ax, double ay, double bx, double by, double cx, double cy)
+{
+  int sign1 = orientSign(ax, ay, bx, by, cx, cy, DBL_EPSILON/2.0);
+
+  if (sign1 != 0)
+    return sign1;
+
+  if (LDBL_MANT_DIG > DBL_MANT_DIG) {
+    using LD = long double;
+
+    sign1 = orientSign<LD>(ax, ay, bx, by, cx, cy, LDBL_EPSILON/2.0L);
+
+    if (sign1 != 0)
+      return sign1;
+  }
+
+  // zero for repeated point
+  if ((ax == bx && ay == by) || (bx == cx && by == cy) || (cx == ax && cy == ay))
+    return 0;
+
+  auto left  = product(diff(ax, cx), diff(by, cy));
+  auto right = product(diff(ay, cy), diff(bx, cx));
+
+  return sign(sum(left, negate(right)));
+}
+
+// sign of in circle test for d and circle through counter clockwise triangle abc
+// (positive if d is inside)
+int
+inCircle(double ax, double ay, double bx, double by, double cx, double cy,
+         double dx, double dy)
+{
+  int sign1 = inCircleSign(ax, ay, bx, by, cx, cy, dx, dy, DBL_EPSILON/2.0);
+
+  if (sign1 != 0)
+    return sign1;
+
+  if (LDBL_MANT_DIG > DBL_MANT_DIG) {
+    using LD = long double;
+
+    sign1 = inCircleSign<LD>(ax, ay, bx, by, cx, cy, dx, dy, LDBL_EPSILON/2.0L);
+
+    if (sign1 != 0)
+      return sign1;
+  }
+
+  // zero if d is one of a, b, c (merge tests candidates against base edge points)
+  if ((dx == ax && dy == ay) || (dx == bx && dy == by) || (dx == cx && dy == cy))
+    return 0;
+
+  auto eadx = diff(ax, dx), eady = diff(ay, dy);
+  auto ebdx = diff(bx, dx), ebdy = diff(by, dy);
+  auto ecdx = diff(cx, dx), ecdy = diff(cy, dy);
+
+  auto ealift = sum(product(eadx, eadx), product(eady, eady));
+  auto eblift = sum(product(ebdx, ebdx), product(ebdy, ebdy));
+  auto eclift = sum(product(ecdx, ecdx), product(ecdy, ecdy));
+
+  auto a = product(ealift, sum(product(ebdx, ecdy), negate(product(ecdx, ebdy))));
+  auto b = product(eblift, sum(product(ecdx, eady), negate(product(eadx, ecdy))));
+  auto c = product(eclift, sum(product(eadx, ebdy), negate(product(ebdx, eady))));
+
+  return sign(sum(sum(a, b), c));
+}
+
+//---
+
+// Guibas-Stolfi divide and conquer triangulation. Edges are quad edges (four consecutive
+// ids for edge, its dual and their reverses), only primal edges have an origin point.
+// Points are copied in sorted order and identified by sorted position.
+class Triangulator {
+ public:
+  Triangulator(const double *x, const double *y, const CDelaunay::Inds &inds) :
+   inds_(inds) {
+    auto n = inds_.size();
+
+    x_.resize(n);
+    y_.resize(n);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      x_[i] = x[inds_[i]];
+      y_[i] = y[inds_[i]];
+    }
+
+    next_ .reserve(12*n);
+    org_  .reserve(12*n);
+    alive_.reserve(3*n);
+
+    if (n >= 2)
+      divide(0, n);
+  }
+
+  CDelaunay::Edges edges() const {
+    CDelaunay::Edges edges;
+
+    for (std::size_t q = 0; q < alive_.size(); ++q) {
+      if (! alive_[q])
+        continue;
+
+      auto e = uint32_t(4*q);
+
+      edges.emplace_back(inds_[org(e)], inds_[dest(e)]);
+    }
+
+    return edges;
+  }
+
+ private:
+  using EdgePair = std::pair<uint32_t, uint32_t>;
+
+  static uint32_t rot   (uint32_t e) { return (e & ~3u) | ((e + 1) & 3u); }
+  static uint32_t sym   (uint32_t e) { return e ^ 2u; }
+  static uint32_t invRot(uint32_t e) { return (e & ~3u) | ((e + 3) & 3u); }
+
+  uint32_t onext(uint32_t e) const { return next_[e]; }
+  uint32_t oprev(uint32_t e) const { return rot(onext(rot(e))); }
+  uint32_t lnext(uint32_t e) const { return rot(onext(invRot(e))); }
+  uint32_t rprev(uint32_t e) const { return onext(sym(e)); }
+
+  uint32_t org (uint32_t e) const { return org_[e]; }
+  uint32_t dest(uint32_t e) const { return org_[sym(e)]; }
+
+  uint32_t makeEdge(uint32_t p1, uint32_t p2) {
+    auto e = uint32_t(next_.size());
+
+    next_.insert(next_.end(), { e, e + 3, e + 2, e + 1 });
+    org_ .insert(org_ .end(), { p1, 0, p2, 0 });
+
+    alive_.push_back(true);
+
+    return e;
+  }
+
+  void splice(uint32_t a, uint32_t b) {
+    auto alpha = rot(onext(a));
+    auto beta  = rot(onext(b));
+
+    std::swap(next_[a    ], next_[b   ]);
+    std::swap(next_[alpha], next_[beta]);
+  }
+
+  // add edge from dest of a to org of b
+  uint32_t connect(uint32_t a, uint32_t b) {
+    auto e = makeEdge(dest(a), org(b));
+
+    splice(e, lnext(a));
+    splice(sym(e), b);
+
+    return e;
+  }
+
+  void deleteEdge(uint32_t e) {
+    splice(e, oprev(e));
+    splice(sym(e), oprev(sym(e)));
+
+    alive_[e >> 2] = false;
+  }
+
+  bool ccw(uint32_t a, uint32_t b, uint32_t c) const {
+    return orient(x_[a], y_[a], x_[b], y_[b], x_[c], y_[c]) > 0;
+  }
+
+  bool rightOf(uint32_t p, uint32_t e) const { return ccw(p, dest(e), org(e)); }
+  bool leftOf (uint32_t p, uint32_t e) const { return ccw(p, org(e), dest(e)); }
+
+  // d inside circle through a, b, c
+  bool inCircle(uint32_t a, uint32_t b, uint32_t c, uint32_t d) const {
+    return ::inCircle(x_[a], y_[a], x_[b], y_[b], x_[c], y_[c], x_[d], y_[d]) > 0;
+  }
+
+  // triangulate points [i1, i2) of inds, returns counter clockwise convex hull edge out
+  // of leftmost point and clockwise convex hull edge out of rightmost point
+  EdgePair divide(std::size_t i1, std::size_t i2) {
+    auto n = i2 - i1;
+
+    if (n == 2) {
+      auto a = makeEdge(uint32_t(i1), uint32_t(i1 + 1));
+
+      return EdgePair(a, sym(a));
+    }
+
+    if (n == 3) {
+      auto p1 = uint32_t(i1), p2 = uint32_t(i1 + 1), p3 = uint32_t(i1 + 2);
+
+      auto a = makeEdge(p1, p2);
+      auto b = makeEdge(p2, p3);
+
+      splice(sym(a), b);
+
+      if (ccw(p1, p2, p3)) {
+        connect(b, a);
+
+        return EdgePair(a, sym(b));
+      }
+
+      if (ccw(p1, p3, p2)) {
+        auto c = connect(b, a);
+
+        return EdgePair(sym(c), c);
+      }
+
+      // collinear
+      return EdgePair(a, sym(b));
+    }
+
+    auto im = i1 + n/2;
+
+    auto l = divide(i1, im);
+    auto r = divide(im, i2);
+
+    auto ldo = l.first, ldi = l.second;
+    auto rdi = r.first, rdo = r.second;
+
+    // lower common tangent of left and right hulls
+    for (;;) {
+      if      (leftOf (org(rdi), ldi)) ldi = lnext(ldi);
+      else if (rightOf(org(ldi), rdi)) rdi = rprev(rdi);
+      else break;
+    }
+
+    auto basel = connect(sym(rdi), ldi);
+
+    if (org(ldi) == org(ldo)) ldo = sym(basel);
+    if (org(rdi) == org(rdo)) rdo = basel;
+
+    auto valid = [&](uint32_t e) { return rightOf(dest(e), basel); };
+
+    // merge upwards from base edge, removing edges which fail in circle test
+    for (;;) {
+      auto lcand = onext(sym(basel));
+
+      if (valid(lcand)) {
+        while (inCircle(dest(basel), org(basel), dest(lcand), dest(onext(lcand)))) {
+          auto t = onext(lcand);
+
+          deleteEdge(lcand);
+
+          lcand = t;
+        }
+      }
+
+      auto rcand = oprev(basel);
+
+      if (valid(rcand)) {
+        while (inCircle(dest(basel), org(basel), dest(rcand), dest(oprev(rcand)))) {
+          auto t = oprev(rcand);
+
+          deleteEdge(rcand);
+
+          rcand = t;
+        }
+      }
+
+      bool lvalid = valid(lcand);
+      bool rvalid = valid(rcand);
+
+      if (! lvalid && ! rvalid)
+        break;
+
+      if (! lvalid || (rvalid && inCircle(dest(lcand), org(lcand), org(rcand), dest(rcand))))
+        basel = connect(rcand, sym(basel));
+      else
+        basel = connect(sym(basel), sym(lcand));
+    }
+
+    return EdgePair(ldo, rdo);
+  }
+
+ private:
+  const CDelaunay::Inds& inds_;
+  std::vector<double>    x_;     // point coordinates in sorted order
+  std::vector<double>    y_;
+  std::vector<uint32_t>  next_;  // onext of each edge
+  std::vector<uint32_t>  org_;   // origin point (sorted position) of each primal edge
+  std::vector<bool>      alive_; // quad edge not deleted
+};
+
+}
+
+//---
+
+namespace CDelaunay {
+
+void
+sortPoints(const double *x, const double *y, Inds &inds)
+{
+  std::sort(inds.begin(), inds.end(), [&](uint32_t i, uint32_t j) {
+    return (x[i] < x[j] || (x[i] == x[j] && y[i] < y[j]));
+  });
+}
+
+Edges
+edges(const double *x, const double *y, const Inds &inds)
+{
+  Triangulator triangulator(x, y, inds);
+
+  return triangulator.edges();
+}
+
+}
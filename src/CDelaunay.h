@@ -0,0 +1,29 @@
+#ifndef CDelaunay_H
+#define CDelaunay_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Delaunay triangulation of points.
+//
+// Uses the Guibas-Stolfi divide and conquer algorithm on a quad edge structure which is
+// O(N log N) in the worst case and handles collinear points. Orientation and in circle
+// tests are exact (floating point with an error bound, falling back to exact expansion
+// arithmetic when the sign is uncertain) so the result is a true Delaunay triangulation
+// even for cocircular points (e.g. points of a ring).
+namespace CDelaunay {
+  using Inds  = std::vector<uint32_t>;
+  using Edge  = std::pair<uint32_t, uint32_t>;
+  using Edges = std::vector<Edge>;
+
+  // sort point indices by x then y
+  void sortPoints(const double *x, const double *y, Inds &inds);
+
+  // edges (pairs of point indices) of Delaunay triangulation of points in inds, which
+  // must be sorted by sortPoints with duplicate points removed
+  Edges edges(const double *x, const double *y, const Inds &inds);
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include <CFactorCache.h>
+#include <CPrime.h>
+
+CFactorCache::
+CFactorCache(std::size_t maxBytes) :
+ maxBytes_(maxBytes)
+{
+}
+
+std::size_t
+CFactorCache::
+maxBytes() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return maxBytes_;
+}
+
+void
+CFactorCache::
+setMaxBytes(std::size_t n)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  maxBytes_ = n;
+
+  evict();
+}
+
+std::size_t
+CFactorCache::
+size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return nodes_.size();
+}
+
+std::size_t
+CFactorCache::
+memUsage() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return nodes_.size()*EntryBytes;
+}
+
+std::size_t
+CFactorCache::
+hits() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return hits_;
+}
+
+std::size_t
+CFactorCache::
+misses() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return misses_;
+}
+
+void
+CFactorCache::
+resetStats()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  hits_   = 0;
+  misses_ = 0;
+}
+
+CFactorCache::Entry
+CFactorCache::
+lookup(int n)
+{
+  Entry entry;
+
+  if (find(n, entry))
+    return entry;
+
+  //---
+
+  // calculate outside lock (another thread may add same value)
+  entry.factors = CPrime::factors(n);
+  entry.prime   = CPrime::isPrime(n);
+
+  //---
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (nodeMap_.find(n) == nodeMap_.end()) {
+    nodes_.push_front(Node { n, entry });
+
+    nodeMap_[n] = nodes_.begin();
+
+    evict();
+  }
+
+  return entry;
+}
+
+bool
+CFactorCache::
+find(int n, Entry &entry)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto p = nodeMap_.find(n);
+
+  if (p == nodeMap_.end()) {
+    ++misses_;
+    return false;
+  }
+
+  ++hits_;
+
+  // move to front (most recently used)
+  nodes_.splice(nodes_.begin(), nodes_, (*p).second);
+
+  entry = (*p).second->entry;
+
+  return true;
+}
+
+void
+CFactorCache::
+clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  nodes_  .clear();
+  nodeMap_.clear();
+}
+
+void
+CFactorCache::
+evict()
+{
+  // remove least recently used until under memory limit
+  while (! nodes_.empty() && nodes_.size()*EntryBytes > maxBytes_) {
+    nodeMap_.erase(nodes_.back().n);
+
+    nodes_.pop_back();
+  }
+}
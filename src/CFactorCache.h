@@ -0,0 +1,76 @@
+#ifndef CFactorCache_H
+#define CFactorCache_H
+
+#include <CPrimeFactors.h>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+// Bounded LRU cache of factors and primality keyed by value.
+//
+// Values missing from the cache are computed with CPrime. When the estimated memory use
+// exceeds the maximum the least recently used values are evicted. Safe to use from
+// multiple threads.
+class CFactorCache {
+ public:
+  using Factors = CPrimeFactors;
+
+  struct Entry {
+    Factors factors;
+    bool    prime { false };
+  };
+
+ public:
+  CFactorCache(std::size_t maxBytes=(1 << 20));
+
+  CFactorCache(const CFactorCache &) = delete;
+  CFactorCache &operator=(const CFactorCache &) = delete;
+
+  //! max memory used by entries
+  std::size_t maxBytes() const;
+  void setMaxBytes(std::size_t n);
+
+  //! number of cached values
+  std::size_t size() const;
+
+  //! estimated memory used by entries
+  std::size_t memUsage() const;
+
+  //! lookup statistics
+  std::size_t hits  () const;
+  std::size_t misses() const;
+
+  void resetStats();
+
+  //! factors and primality of n (n > 0)
+  Entry lookup(int n);
+
+  void clear();
+
+ private:
+  struct Node {
+    int   n { 0 };
+    Entry entry;
+  };
+
+  using Nodes   = std::list<Node>; // most recently used first
+  using NodeMap = std::unordered_map<int, Nodes::iterator>;
+
+  // approximate bytes per entry (list node, map node and bucket)
+  static constexpr std::size_t EntryBytes = sizeof(Node) + 2*sizeof(void *) +
+                                            sizeof(NodeMap::value_type) + 3*sizeof(void *);
+
+  bool find(int n, Entry &entry);
+
+  void evict();
+
+ private:
+  mutable std::mutex mutex_;
+  Nodes              nodes_;
+  NodeMap            nodeMap_;
+  std::size_t        maxBytes_ { 0 };
+  std::size_t        hits_     { 0 };
+  std::size_t        misses_   { 0 };
+};
+
+#endif
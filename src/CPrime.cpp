@@ -1,34 +1,76 @@
 #include <CPrime.h>
+#include <CPrimeSieve.h>
+#include <CPrimeSPF.h>
+#include <CPrimeRho.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
-#include <set>
+#include <thread>
 
 #define CPrimeMgrInst CPrimeMgr::instance()
 
 class CPrimeMgr {
+ public:
+  using Factors = CPrimeFactors64;
+
+  // values up to this are tested with sieve, larger values use Miller-Rabin
+  static constexpr uint64_t SieveBound = 1 << 26;
+
+  // largest prime used for trial division before Pollard's rho
+  static constexpr uint32_t TrialBound = 1 << 10;
+
+  // values per segment for factorRange (sized so segment factor slots fit in L2)
+  static constexpr uint64_t SegmentSize = 1 << 12;
+
  public:
   static CPrimeMgr *instance();
 
-  bool isPrime(int i) const;
+  bool isPrime(uint64_t n) const;
+
+  void factors(uint64_t n, Factors &f) const;
 
-  std::vector<int> factors(int n) const;
+  void factorRange(uint64_t lo, uint64_t hi, const CPrime::FactorRangeProc &proc,
+                   int numThreads) const;
+
+  int factorTableBound() const { return int(spf_.bound()); }
+  void setFactorTableBound(int n) { spf_.setBound(uint64_t(std::max(n, 0))); }
 
  private:
-  CPrimeMgr() { }
- ~CPrimeMgr() { }
+  struct RangePrime {
+    uint32_t p   { 0 }; // odd prime
+    uint64_t inv { 0 }; // inverse of p mod 2^64 (low bits give inverse mod 2^32)
+  };
 
-  void initPrimes();
+  using RangePrimes = std::vector<RangePrime>;
 
-  void genPrime(int n) const;
+  struct SegmentFactor {
+    uint32_t p { 0 }; // prime
+    uint32_t e { 0 }; // exponent
+  };
 
-  bool checkPrime(int n) const;
+  // max distinct primes <= 2^32 in a 64-bit value
+  static constexpr std::size_t MaxSegmentFactors = 15;
+
+  struct Segment {
+    std::vector<uint64_t>      rem;        // unfactored part of each value
+    std::vector<uint8_t>       numFactors; // number of distinct primes found for value
+    std::vector<SegmentFactor> factors;    // MaxSegmentFactors slots per value
+    Factors                    f;          // factors for callback
+  };
 
  private:
-  using Primes = std::set<int>;
+  CPrimeMgr() : spf_(sieve_) { }
+ ~CPrimeMgr() { }
 
-  mutable Primes primes_;
-  mutable int    primeMax_ { 0 };
+  void factorSegment(uint64_t lo, uint64_t hi, const RangePrimes &primes,
+                     Segment &segment, const CPrime::FactorRangeProc &proc) const;
+
+ private:
+  // both tables are thread safe (lock free below their current limit)
+  mutable CPrimeSieve sieve_; // grown on demand
+  mutable CPrimeSPF   spf_;   // smallest prime factors, grown on demand up to bound
 };
 
 //------
@@ -37,95 +79,263 @@ CPrimeMgr *
 CPrimeMgr::
 instance()
 {
-  static CPrimeMgr *inst;
-
-  if (! inst) {
-    inst = new CPrimeMgr;
-
-    inst->initPrimes();
-  }
-
-  return inst;
-}
-
-void
-CPrimeMgr::
-initPrimes()
-{
-  primes_.insert(5);
-  primes_.insert(7);
+  // thread safe initialization
+  static CPrimeMgr inst;
 
-  primeMax_ = 10;
+  return &inst;
 }
 
 bool
 CPrimeMgr::
-isPrime(int i) const
+isPrime(uint64_t n) const
 {
-  assert(i > 0);
+  assert(n > 0);
 
-  if (i <= 3) return true;
+  if (n <= 3) return true;
 
-  genPrime(i);
+  if ((n & 1) == 0) return false;
 
-  return (primes_.find(i) != primes_.end());
+  if (n <= std::max(sieve_.limit(), SieveBound))
+    return sieve_.isPrime(n);
+
+  return CPrimeRho::isPrime(n);
 }
 
 void
 CPrimeMgr::
-genPrime(int n) const
+factors(uint64_t n, Factors &f) const
 {
-  if (n <= primeMax_)
+  assert(n > 0);
+
+  f.clear();
+
+  if (n == 1) {
+    f.push_back(1);
     return;
+  }
+
+  auto m = n;
+
+  // remove factors of two
+  while ((m & 1) == 0) {
+    f.push_back(2);
 
-  for (int i = primeMax_ + 1; i <= n; ++i) {
-    if (checkPrime(i))
-      primes_.insert(i);
+    m >>= 1;
   }
 
-  primeMax_ = n;
+  // trial divide by small primes until remaining value is in factor table
+  auto bound = spf_.bound();
+
+  if (m > bound) {
+    for (auto p : sieve_.basePrimes()) {
+      if (p > TrialBound || uint64_t(p)*p > m)
+        break;
+
+      while (m % p == 0) {
+        f.push_back(p);
+
+        m /= p;
+      }
+
+      if (m <= bound)
+        break;
+    }
+  }
+
+  if (m > 1 && m <= bound) {
+    // chain of smallest prime factor lookups
+    spf_.extend(m);
+
+    while (m > 1) {
+      auto p = spf_.spf(m);
+
+      if (! p) break;
+
+      f.push_back(p);
+
+      m /= p;
+    }
+
+    // remaining value is prime
+    if (m > 1)
+      f.push_back(m);
+  }
+  else if (m > 1) {
+    // remaining factors are all larger than trial primes
+    CPrimeRho::factors(m, f);
+  }
+
+  // largest factor first
+  f.sort();
 }
 
-bool
+void
 CPrimeMgr::
-checkPrime(int n) const
+factorRange(uint64_t lo, uint64_t hi, const CPrime::FactorRangeProc &proc, int numThreads) const
 {
-  for (Primes::const_iterator p = primes_.begin(); p != primes_.end(); ++p) {
-    int i = *p;
+  assert(lo > 0 && lo <= hi);
+
+  // odd primes up to sqrt(hi) from shared sieve
+  auto rootHi = std::min(uint64_t(std::sqrt(double(hi))), CPrimeSieve::MaxLimit);
+
+  while (rootHi*rootHi > hi) --rootHi;
+  while (rootHi < CPrimeSieve::MaxLimit && (rootHi + 1)*(rootHi + 1) <= hi) ++rootHi;
 
-    if (n % i == 0) return false;
+  sieve_.extend(rootHi);
+
+  std::vector<uint32_t> primes1;
+
+  sieve_.getPrimes(rootHi, primes1);
+
+  RangePrimes primes;
+
+  primes.reserve(primes1.size());
+
+  for (auto p : primes1) {
+    // p*inv = 1 (mod 2^64) by Newton iteration
+    uint64_t inv = p;
+
+    for (int i = 0; i < 5; ++i)
+      inv *= 2 - p*inv;
+
+    primes.push_back(RangePrime { p, inv });
   }
 
-  return true;
+  //---
+
+  // workers take segments in turn
+  auto numSegments = (hi - lo)/SegmentSize + 1;
+
+  std::atomic<uint64_t> nextSegment { 0 };
+
+  auto worker = [&]() {
+    Segment segment;
+
+    for (;;) {
+      auto i = nextSegment++;
+
+      if (i >= numSegments)
+        break;
+
+      auto lo1 = lo + i*SegmentSize;
+      auto hi1 = (hi - lo1 < SegmentSize ? hi : lo1 + SegmentSize - 1);
+
+      factorSegment(lo1, hi1, primes, segment, proc);
+    }
+  };
+
+  if (numThreads <= 0)
+    numThreads = std::max(int(std::thread::hardware_concurrency()), 1);
+
+  numThreads = int(std::min(uint64_t(numThreads), numSegments));
+
+  std::vector<std::thread> threads;
+
+  for (int i = 1; i < numThreads; ++i)
+    threads.emplace_back(worker);
+
+  worker();
+
+  for (auto &thread : threads)
+    thread.join();
 }
 
-std::vector<int>
+void
 CPrimeMgr::
-factors(int n) const
+factorSegment(uint64_t lo, uint64_t hi, const RangePrimes &primes,
+              Segment &segment, const CPrime::FactorRangeProc &proc) const
 {
-  std::vector<int> v;
+  auto n = std::size_t(hi - lo + 1);
 
-  if (isPrime(n))
-    v.push_back(n);
-  else {
-    int n1 = n/2;
+  auto &rem        = segment.rem;
+  auto &numFactors = segment.numFactors;
+  auto &factors    = segment.factors;
 
-    for (int i = n1; i >= 2; --i) {
-      if (! isPrime(i)) continue;
+  rem       .resize(n);
+  numFactors.assign(n, 0);
+  factors   .resize(n*MaxSegmentFactors);
 
-      if (n % i != 0) continue;
+  // factors are added smallest first
+  auto addFactor = [&](std::size_t i, uint32_t p, uint32_t e) {
+    factors[i*MaxSegmentFactors + numFactors[i]++] = SegmentFactor { p, e };
+  };
 
-      v.push_back(i);
+  // remove factors of two
+  for (std::size_t i = 0; i < n; ++i) {
+    auto v = lo + i;
 
-      std::vector<int> v1 = factors(n / i);
+    auto e = uint32_t(__builtin_ctzll(v));
 
-      std::copy(v1.begin(), v1.end(), std::back_inserter(v));
+    rem[i] = v >> e;
 
-      break;
-    }
+    if (e)
+      addFactor(i, 2, e);
   }
 
-  return v;
+  // remove odd primes <= sqrt(hi).
+  // Values are divided exactly by multiplying by the inverse of p, and q is divisible by
+  // p when q*inverse <= max/p (using 32-bit values when possible as these are faster)
+  auto removePrimes = [&](auto t) {
+    using T = decltype(t);
+
+    for (const auto &prime : primes) {
+      auto p   = prime.p;
+      auto inv = T(prime.inv);
+      auto max = T(T(-1)/p);
+
+      auto r = lo % p;
+
+      for (std::size_t i = (r ? p - r : 0); i < n; i += p) {
+        T        v = T(T(rem[i])*inv);
+        uint32_t e = 1;
+
+        for (;;) {
+          T v1 = T(v*inv);
+
+          if (v1 > max) break;
+
+          v = v1;
+
+          ++e;
+        }
+
+        rem[i] = v;
+
+        addFactor(i, p, e);
+      }
+    }
+  };
+
+  if (hi <= 0xFFFFFFFF)
+    removePrimes(uint32_t());
+  else
+    removePrimes(uint64_t());
+
+  //---
+
+  auto &f = segment.f;
+
+  for (std::size_t i = 0; i < n; ++i) {
+    f.clear();
+
+    if (lo + i == 1)
+      f.push_back(1);
+
+    // any remaining value is a prime > sqrt(hi)
+    if (rem[i] > 1)
+      f.push_back(rem[i]);
+
+    const auto *factors1 = &factors[i*MaxSegmentFactors];
+
+    for (auto j = numFactors[i]; j > 0; --j) {
+      const auto &factor = factors1[j - 1];
+
+      for (uint32_t e = 0; e < factor.e; ++e)
+        f.push_back(factor.p);
+    }
+
+    proc(lo + i, f);
+  }
 }
 
 //---
@@ -134,12 +344,64 @@ bool
 CPrime::
 isPrime(int i)
 {
-  return CPrimeMgrInst->isPrime(i);
+  assert(i > 0);
+
+  return CPrimeMgrInst->isPrime(uint64_t(i));
+}
+
+bool
+CPrime::
+isPrime(uint64_t n)
+{
+  return CPrimeMgrInst->isPrime(n);
 }
 
-std::vector<int>
+CPrimeFactors
 CPrime::
 factors(int n)
 {
-  return CPrimeMgrInst->factors(n);
+  assert(n > 0);
+
+  CPrimeMgr::Factors f;
+
+  CPrimeMgrInst->factors(uint64_t(n), f);
+
+  CPrimeFactors f1;
+
+  for (auto p : f)
+    f1.push_back(int(p));
+
+  return f1;
+}
+
+CPrimeFactors64
+CPrime::
+factors(uint64_t n)
+{
+  CPrimeMgr::Factors f;
+
+  CPrimeMgrInst->factors(n, f);
+
+  return f;
+}
+
+int
+CPrime::
+factorTableBound()
+{
+  return CPrimeMgrInst->factorTableBound();
+}
+
+void
+CPrime::
+setFactorTableBound(int n)
+{
+  CPrimeMgrInst->setFactorTableBound(n);
+}
+
+void
+CPrime::
+factorRange(uint64_t lo, uint64_t hi, const FactorRangeProc &proc, int numThreads)
+{
+  CPrimeMgrInst->factorRange(lo, hi, proc, numThreads);
 }
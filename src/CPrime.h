@@ -1,12 +1,28 @@
 #ifndef CPrime_H
 #define CPrime_H
 
-#include <vector>
+#include <CPrimeFactors.h>
+#include <functional>
 
 namespace CPrime {
+  // note: 1 is treated as prime
   bool isPrime(int i);
+  bool isPrime(uint64_t n);
 
-  std::vector<int> factors(int n);
+  // prime factors of n, largest first
+  CPrimeFactors   factors(int n);
+  CPrimeFactors64 factors(uint64_t n);
+
+  // factor all values in [lo, hi] (lo > 0) with a segmented sieve split across threads
+  // (0 for one per core). proc is called from the worker threads with the factors of each
+  // value (largest first), in increasing order within each segment.
+  using FactorRangeProc = std::function<void (uint64_t n, const CPrimeFactors64 &f)>;
+
+  void factorRange(uint64_t lo, uint64_t hi, const FactorRangeProc &proc, int numThreads=0);
+
+  // factors below bound use a smallest prime factor table (0 to disable table)
+  int factorTableBound();
+  void setFactorTableBound(int n);
 }
 
 #endif
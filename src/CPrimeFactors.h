@@ -0,0 +1,164 @@
+#ifndef CPrimeFactors_H
+#define CPrimeFactors_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+// Fixed capacity list of prime factors (no heap allocation).
+//
+// A value of N bits has at most N prime factors (powers of two), so a 31 entry list holds
+// the factors of any positive int and a 64 entry list those of any uint64_t.
+//
+// Factors are stored flat (largest first) and can also be walked as (prime, exponent)
+// pairs with powers().
+template<typename T, std::size_t N>
+class CPrimeFactorsT {
+ public:
+  using value_type     = T;
+  using const_iterator = const T *;
+
+  static constexpr std::size_t MaxFactors = N;
+
+  struct Power {
+    T   prime    { 0 };
+    int exponent { 0 };
+  };
+
+  // iterator over runs of equal factors
+  class PowerIterator {
+   public:
+    PowerIterator(const T *p, const T *end) :
+     p_(p), end_(end) {
+    }
+
+    Power operator*() const {
+      Power power;
+
+      power.prime = *p_;
+
+      for (auto *p = p_; p != end_ && *p == *p_; ++p)
+        ++power.exponent;
+
+      return power;
+    }
+
+    PowerIterator &operator++() {
+      auto prime = *p_;
+
+      while (p_ != end_ && *p_ == prime)
+        ++p_;
+
+      return *this;
+    }
+
+    bool operator==(const PowerIterator &rhs) const { return p_ == rhs.p_; }
+    bool operator!=(const PowerIterator &rhs) const { return p_ != rhs.p_; }
+
+   private:
+    const T *p_   { nullptr };
+    const T *end_ { nullptr };
+  };
+
+  class Powers {
+   public:
+    Powers(const T *begin, const T *end) :
+     begin_(begin), end_(end) {
+    }
+
+    PowerIterator begin() const { return PowerIterator(begin_, end_); }
+    PowerIterator end  () const { return PowerIterator(end_  , end_); }
+
+   private:
+    const T *begin_ { nullptr };
+    const T *end_   { nullptr };
+  };
+
+ public:
+  CPrimeFactorsT() { }
+
+  CPrimeFactorsT(std::initializer_list<T> factors) {
+    for (auto f : factors)
+      push_back(f);
+  }
+
+  //---
+
+  // flat view
+  bool empty() const { return n_ == 0; }
+
+  std::size_t size() const { return n_; }
+
+  T operator[](std::size_t i) const { assert(i < n_); return f_[i]; }
+
+  T front() const { assert(n_ > 0); return f_[0]; }
+  T back () const { assert(n_ > 0); return f_[n_ - 1]; }
+
+  const_iterator begin() const { return f_; }
+  const_iterator end  () const { return f_ + n_; }
+
+  //---
+
+  // prime power view
+  Powers powers() const { return Powers(begin(), end()); }
+
+  std::size_t numPowers() const {
+    std::size_t n = 0;
+
+    for (std::size_t i = 0; i < n_; ++i) {
+      if (i == 0 || f_[i] != f_[i - 1])
+        ++n;
+    }
+
+    return n;
+  }
+
+  //---
+
+  void clear() { n_ = 0; }
+
+  void push_back(T f) {
+    assert(n_ < N);
+
+    f_[n_++] = f;
+  }
+
+  // sort largest first (insertion sort, lists are short and mostly sorted)
+  void sort() {
+    for (std::size_t i = 1; i < n_; ++i) {
+      auto f = f_[i];
+
+      auto j = i;
+
+      for ( ; j > 0 && f_[j - 1] < f; --j)
+        f_[j] = f_[j - 1];
+
+      f_[j] = f;
+    }
+  }
+
+  //---
+
+  friend bool operator==(const CPrimeFactorsT &lhs, const CPrimeFactorsT &rhs) {
+    if (lhs.n_ != rhs.n_) return false;
+
+    for (std::size_t i = 0; i < lhs.n_; ++i)
+      if (lhs.f_[i] != rhs.f_[i]) return false;
+
+    return true;
+  }
+
+  friend bool operator!=(const CPrimeFactorsT &lhs, const CPrimeFactorsT &rhs) {
+    return ! (lhs == rhs);
+  }
+
+ private:
+  T       f_[N];     // factors (first n_ valid)
+  uint8_t n_ { 0 };  // number of factors
+};
+
+using CPrimeFactors   = CPrimeFactorsT<int     , 31>;
+using CPrimeFactors64 = CPrimeFactorsT<uint64_t, 64>;
+
+#endif
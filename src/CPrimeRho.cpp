@@ -0,0 +1,205 @@
+#include <CPrimeRho.h>
+
+#include <cassert>
+
+namespace {
+
+using uint128 = unsigned __int128;
+
+// Montgomery arithmetic modulo odd n with R = 2^64
+class Montgomery {
+ public:
+  Montgomery(uint64_t n) :
+   n_(n) {
+    assert(n & 1);
+
+    // n*inv = 1 (mod 2^64) by Newton iteration (each step doubles correct bits)
+    uint64_t inv = n;
+
+    for (int i = 0; i < 5; ++i)
+      inv *= 2 - n*inv;
+
+    inv_ = inv;
+
+    uint64_t r = (0 - n) % n; // R mod n
+
+    r2_ = uint64_t(uint128(r)*r % n);
+  }
+
+  uint64_t n() const { return n_; }
+
+  // t*R^-1 mod n, result in [0, n)
+  uint64_t reduce(uint128 t) const {
+    uint64_t m = uint64_t(t)*inv_;
+
+    uint64_t th = uint64_t(t >> 64);
+    uint64_t mh = uint64_t((uint128(m)*n_) >> 64);
+
+    return (th >= mh ? th - mh : th - mh + n_);
+  }
+
+  uint64_t mul(uint64_t a, uint64_t b) const { return reduce(uint128(a)*b); }
+
+  uint64_t to  (uint64_t a) const { return mul(a % n_, r2_); }
+  uint64_t from(uint64_t a) const { return reduce(a); }
+
+  uint64_t add(uint64_t a, uint64_t b) const {
+    uint64_t s = a + b;
+
+    return (s >= n_ || s < a ? s - n_ : s);
+  }
+
+  uint64_t pow(uint64_t a, uint64_t e) const {
+    uint64_t r = to(1);
+
+    while (e) {
+      if (e & 1) r = mul(r, a);
+
+      a = mul(a, a);
+
+      e >>= 1;
+    }
+
+    return r;
+  }
+
+ private:
+  uint64_t n_   { 0 };
+  uint64_t inv_ { 0 };
+  uint64_t r2_  { 0 };
+};
+
+uint64_t gcd(uint64_t a, uint64_t b) {
+  while (b) {
+    uint64_t t = a % b;
+
+    a = b;
+    b = t;
+  }
+
+  return a;
+}
+
+}
+
+//---
+
+bool
+CPrimeRho::
+isPrime(uint64_t n)
+{
+  assert(n > 3 && (n & 1));
+
+  // bases which give a deterministic test for all n < 2^64 (Jim Sinclair)
+  static const uint64_t bases[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+
+  Montgomery mont(n);
+
+  uint64_t d = n - 1;
+  int      s = 0;
+
+  while ((d & 1) == 0) {
+    d >>= 1;
+
+    ++s;
+  }
+
+  uint64_t one      = mont.to(1);
+  uint64_t minusOne = mont.to(n - 1);
+
+  for (auto a : bases) {
+    a %= n;
+
+    if (a == 0) continue;
+
+    uint64_t x = mont.pow(mont.to(a), d);
+
+    if (x == one || x == minusOne) continue;
+
+    bool composite = true;
+
+    for (int i = 1; i < s; ++i) {
+      x = mont.mul(x, x);
+
+      if (x == minusOne) {
+        composite = false;
+        break;
+      }
+    }
+
+    if (composite)
+      return false;
+  }
+
+  return true;
+}
+
+uint64_t
+CPrimeRho::
+findFactor(uint64_t n)
+{
+  assert(n & 1);
+
+  Montgomery mont(n);
+
+  const int m = 128; // steps between gcds
+
+  for (uint64_t c0 = 1; ; ++c0) {
+    uint64_t c = mont.to(c0);
+
+    auto f = [&](uint64_t x) { return mont.add(mont.mul(x, x), c); };
+
+    uint64_t x = 0, y = mont.to(2), ys = 0, q = mont.to(1), g = 1;
+
+    // Brent's cycle detection, accumulating products of |x - y| for batched gcds
+    for (uint64_t r = 1; g == 1; r <<= 1) {
+      x = y;
+
+      for (uint64_t i = 0; i < r; ++i)
+        y = f(y);
+
+      for (uint64_t k = 0; k < r && g == 1; k += m) {
+        ys = y;
+
+        for (uint64_t i = 0; i < m && i < r - k; ++i) {
+          y = f(y);
+
+          q = mont.mul(q, (x > y ? x - y : y - x));
+        }
+
+        g = gcd(mont.from(q), n);
+      }
+    }
+
+    // product overshot, step back one at a time from last saved point
+    if (g == n) {
+      do {
+        ys = f(ys);
+
+        g = gcd(x > ys ? x - ys : ys - x, n);
+      } while (g == 1);
+    }
+
+    if (g != n)
+      return g;
+
+    // cycle with no factor, retry with new constant
+  }
+}
+
+void
+CPrimeRho::
+factors(uint64_t n, CPrimeFactors64 &f)
+{
+  assert(n > 1 && (n & 1));
+
+  if (n <= 3 || isPrime(n)) {
+    f.push_back(n);
+    return;
+  }
+
+  uint64_t d = findFactor(n);
+
+  factors(d    , f);
+  factors(n / d, f);
+}
@@ -0,0 +1,22 @@
+#ifndef CPrimeRho_H
+#define CPrimeRho_H
+
+#include <CPrimeFactors.h>
+
+// 64-bit primality test and factorization which need no tables.
+//
+// Primality uses a deterministic Miller-Rabin test (bases valid for all 64-bit values)
+// and factoring uses Brent's variant of Pollard's rho. Both use Montgomery multiplication
+// so the modular arithmetic needs no 128-bit division.
+namespace CPrimeRho {
+  // n must be odd and > 3
+  bool isPrime(uint64_t n);
+
+  // find a non-trivial factor of odd composite n
+  uint64_t findFactor(uint64_t n);
+
+  // append prime factors (unsorted) of odd n > 1 to f
+  void factors(uint64_t n, CPrimeFactors64 &f);
+}
+
+#endif
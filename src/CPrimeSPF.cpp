@@ -0,0 +1,81 @@
+#include <CPrimeSPF.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+CPrimeSPF::
+CPrimeSPF(const CPrimeSieve &sieve) :
+ sieve_(sieve)
+{
+}
+
+CPrimeSPF::
+~CPrimeSPF()
+{
+  auto nb = numBlocks_.load();
+
+  for (std::size_t b = 0; b < nb; ++b)
+    delete [] blocks_[b].load();
+}
+
+void
+CPrimeSPF::
+setBound(uint64_t n)
+{
+  bound_.store(std::min(n, CPrimeSieve::MaxLimit));
+}
+
+void
+CPrimeSPF::
+extend(uint64_t n)
+{
+  auto nb = std::size_t(n/BlockSpan) + 1;
+
+  if (nb <= numBlocks_.load(std::memory_order_acquire))
+    return;
+
+  assert(n <= CPrimeSieve::MaxLimit);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (auto b = numBlocks_.load(); b < nb; ++b) {
+    auto *entries = new Entry[BlockSize];
+
+    buildBlock(b, entries);
+
+    blocks_[b].store(entries, std::memory_order_relaxed);
+
+    numBlocks_.store(b + 1, std::memory_order_release);
+    limit_    .store(uint64_t(b + 1)*BlockSpan - 1, std::memory_order_release);
+  }
+}
+
+void
+CPrimeSPF::
+buildBlock(std::size_t b, Entry *entries) const
+{
+  std::memset(entries, 0, BlockSize*sizeof(Entry));
+
+  uint64_t lo = uint64_t(b)*BlockSpan;
+  uint64_t hi = lo + BlockSpan - 1;
+
+  // primes in increasing order so first prime to reach an entry is the smallest
+  for (auto p : sieve_.basePrimes()) {
+    if (uint64_t(p)*p > hi)
+      break;
+
+    uint64_t m = uint64_t(p)*p;
+
+    if (m < lo) {
+      m = ((lo + p - 1)/p)*p;
+
+      if ((m & 1) == 0) m += p;
+    }
+
+    for (uint64_t i = (m - lo) >> 1; i < BlockSize; i += p) {
+      if (! entries[i])
+        entries[i] = Entry(p);
+    }
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef CPrimeSPF_H
+#define CPrimeSPF_H
+
+#include <CPrimeSieve.h>
+
+// Smallest prime factor table for odd values.
+//
+// Entry i holds the smallest prime factor of the odd value 2*i + 1, or 0 if the value is
+// prime (or 1). Composite values below 2^32 have a smallest factor below 2^16 so entries
+// are 16-bit. The table is built in the same blocks as CPrimeSieve, on demand, up to a
+// configurable bound.
+//
+// As for CPrimeSieve, lookups below limit() need no locking and growth is serialized and
+// published with an atomic limit. Blocks are kept until destruction, so lowering the bound
+// only stops further growth.
+class CPrimeSPF {
+ public:
+  using Entry = uint16_t;
+
+  static constexpr std::size_t BlockSize = CPrimeSieve::BlockBits;  // odd values per block
+  static constexpr uint64_t    BlockSpan = CPrimeSieve::BlockSpan;  // values per block
+  static constexpr std::size_t MaxBlocks = CPrimeSieve::MaxBlocks;
+
+ public:
+  CPrimeSPF(const CPrimeSieve &sieve);
+ ~CPrimeSPF();
+
+  CPrimeSPF(const CPrimeSPF &) = delete;
+  CPrimeSPF &operator=(const CPrimeSPF &) = delete;
+
+  //! maximum value table will be built to (0 to disable)
+  uint64_t bound() const { return bound_.load(std::memory_order_relaxed); }
+  void setBound(uint64_t n);
+
+  //! largest value currently in table (0 if none)
+  uint64_t limit() const { return limit_.load(std::memory_order_acquire); }
+
+  //! build table up to n (rounded up to block size), caller checks n against bound()
+  void extend(uint64_t n);
+
+  //! smallest prime factor of odd value already in table (n <= limit()), 0 if prime
+  uint32_t spf(uint64_t n) const {
+    uint64_t i = n >> 1;
+
+    const Entry *entries = blocks_[std::size_t(i/BlockSize)].load(std::memory_order_relaxed);
+
+    return entries[i % BlockSize];
+  }
+
+  //! memory used by table
+  std::size_t memUsage() const { return numBlocks_.load()*BlockSize*sizeof(Entry); }
+
+ private:
+  void buildBlock(std::size_t b, Entry *entries) const;
+
+ private:
+  using BlockPtr = std::atomic<const Entry *>;
+
+  const CPrimeSieve&       sieve_;                  // source of base primes
+  BlockPtr                 blocks_[MaxBlocks] {};   // built blocks
+  std::atomic<std::size_t> numBlocks_ { 0 };        // number of built blocks
+  std::atomic<uint64_t>    limit_     { 0 };        // last value in table
+  std::atomic<uint64_t>    bound_     { 1 << 24 };  // max value for table
+  std::mutex               mutex_;                  // serialize growth
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include <CPrimeSieve.h>
+
+#include <cassert>
+#include <cstring>
+
+CPrimeSieve::
+CPrimeSieve()
+{
+  // first block holds all base primes needed for the 32-bit range
+  static_assert(BlockSpan > 0x10000, "first block must contain primes < 2^16");
+
+  extend(1);
+
+  for (uint32_t p = 3; p < 0x10000; p += 2) {
+    if (testPrime(p))
+      basePrimes_.push_back(p);
+  }
+}
+
+CPrimeSieve::
+~CPrimeSieve()
+{
+  auto nb = numBlocks_.load();
+
+  for (std::size_t b = 0; b < nb; ++b)
+    delete [] blocks_[b].load();
+}
+
+void
+CPrimeSieve::
+extend(uint64_t n)
+{
+  auto nb = std::size_t(n/BlockSpan) + 1;
+
+  if (nb <= numBlocks_.load(std::memory_order_acquire))
+    return;
+
+  assert(n <= MaxLimit);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // re-check, another thread may have grown sieve while waiting for lock
+  for (auto b = numBlocks_.load(); b < nb; ++b) {
+    auto *words = new Word[BlockWords];
+
+    sieveBlock(b, words);
+
+    blocks_[b].store(words, std::memory_order_relaxed);
+
+    // publish block
+    numBlocks_.store(b + 1, std::memory_order_release);
+    limit_    .store(uint64_t(b + 1)*BlockSpan - 1, std::memory_order_release);
+  }
+}
+
+bool
+CPrimeSieve::
+isPrime(uint64_t n)
+{
+  if (n > limit())
+    extend(n);
+
+  return testPrime(n);
+}
+
+void
+CPrimeSieve::
+getPrimes(uint64_t n, std::vector<uint32_t> &primes) const
+{
+  assert(n <= limit());
+
+  auto nb = std::size_t((n >> 1)/BlockBits) + 1;
+
+  for (std::size_t b = 0; b < nb; ++b) {
+    const Word *words = blocks_[b].load(std::memory_order_relaxed);
+
+    uint64_t i0 = uint64_t(b)*BlockBits;
+
+    for (std::size_t w = 0; w < BlockWords; ++w) {
+      // clear bits are primes
+      Word bits = ~words[w];
+
+      while (bits) {
+        uint64_t i = i0 + 64*w + uint64_t(__builtin_ctzll(bits));
+
+        uint64_t p = 2*i + 1;
+
+        if (p > n)
+          return;
+
+        primes.push_back(uint32_t(p));
+
+        bits &= bits - 1;
+      }
+    }
+  }
+}
+
+void
+CPrimeSieve::
+sieveBlock(std::size_t b, Word *words) const
+{
+  std::memset(words, 0, BlockBytes);
+
+  uint64_t lo = uint64_t(b)*BlockSpan; // first value (even)
+  uint64_t hi = lo + BlockSpan - 1;    // last value (odd)
+
+  // mark odd multiples of p, starting at p^2, in this block
+  auto markPrime = [&](uint64_t p) {
+    uint64_t m = p*p;
+
+    if (m < lo) {
+      // first odd multiple of p >= lo
+      m = ((lo + p - 1)/p)*p;
+
+      if ((m & 1) == 0) m += p;
+    }
+
+    for (uint64_t i = (m - lo) >> 1; i < BlockBits; i += p)
+      words[i >> 6] |= Word(1) << (i & 63);
+  };
+
+  if (b == 0) {
+    // 1 is not prime
+    words[0] |= 1;
+
+    // bits below p^2 are already final so first block is sieved in place
+    for (uint64_t p = 3; p*p <= hi; p += 2) {
+      uint64_t i = p >> 1;
+
+      if (! ((words[i >> 6] >> (i & 63)) & 1))
+        markPrime(p);
+    }
+  }
+  else {
+    for (auto p : basePrimes_) {
+      if (uint64_t(p)*p > hi)
+        break;
+
+      markPrime(p);
+    }
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef CPrimeSieve_H
+#define CPrimeSieve_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Odd-only, bit-packed Sieve of Eratosthenes.
+//
+// Bit i of the sieve represents the odd number 2*i + 1 (bit set if composite). The bits
+// are stored in L1 cache sized blocks which are sieved one at a time, so the sieve grows
+// on demand one block at a time and never re-sieves existing values.
+//
+// The sieve is safe to use from multiple threads. Blocks never move once sieved, so values
+// below limit() are read with no locking. Growth is serialized by a mutex and published by
+// storing the new limit (release) after the new block pointers.
+class CPrimeSieve {
+ public:
+  using Word = uint64_t;
+
+  static constexpr std::size_t BlockBytes = 32*1024;                 // L1 data cache
+  static constexpr std::size_t BlockWords = BlockBytes/sizeof(Word);
+  static constexpr std::size_t BlockBits  = 8*BlockBytes;            // odd values per block
+  static constexpr uint64_t    BlockSpan  = 2*uint64_t(BlockBits);   // values per block
+
+  static constexpr uint64_t MaxLimit = 0xFFFFFFFF;                   // 32-bit range
+
+  static constexpr std::size_t MaxBlocks = std::size_t((MaxLimit + 1)/BlockSpan);
+
+ public:
+  CPrimeSieve();
+ ~CPrimeSieve();
+
+  CPrimeSieve(const CPrimeSieve &) = delete;
+  CPrimeSieve &operator=(const CPrimeSieve &) = delete;
+
+  //! largest value currently sieved
+  uint64_t limit() const { return limit_.load(std::memory_order_acquire); }
+
+  //! sieve all values up to n (rounded up to block size)
+  void extend(uint64_t n);
+
+  //! test value, extending sieve if needed
+  bool isPrime(uint64_t n);
+
+  //! test value already in sieve (n <= limit())
+  bool testPrime(uint64_t n) const {
+    if (n < 2) return false;
+
+    if ((n & 1) == 0) return (n == 2);
+
+    uint64_t i = n >> 1;
+
+    const Word *words = blocks_[std::size_t(i/BlockBits)].load(std::memory_order_relaxed);
+
+    i %= BlockBits;
+
+    return ! ((words[i >> 6] >> (i & 63)) & 1);
+  }
+
+  //! get odd primes <= n (n <= limit())
+  void getPrimes(uint64_t n, std::vector<uint32_t> &primes) const;
+
+  //! odd primes used to sieve blocks (all odd primes below 2^16)
+  const std::vector<uint32_t> &basePrimes() const { return basePrimes_; }
+
+  //! memory used by sieve bits
+  std::size_t memUsage() const { return numBlocks_.load()*BlockBytes; }
+
+ private:
+  void sieveBlock(std::size_t b, Word *words) const;
+
+ private:
+  using BlockPtr = std::atomic<const Word *>;
+
+  BlockPtr                 blocks_[MaxBlocks] {};  // sieved blocks
+  std::atomic<std::size_t> numBlocks_ { 0 };       // number of sieved blocks
+  std::atomic<uint64_t>    limit_     { 0 };       // last sieved value
+  std::mutex               mutex_;                 // serialize growth
+  std::vector<uint32_t>    basePrimes_;            // odd primes < 2^16
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include <CQFactor.h>
+#include <CCircleMatch.h>
 
 #ifdef USE_CQ_APP
 #include <CQApp.h>
@@ -12,8 +13,13 @@
 #include <QCheckBox>
 #include <QSpinBox>
 #include <QLabel>
+#include <QThread>
 #include <QTimer>
 #include <QPainter>
+#include <QPainterPath>
+#include <QPaintEvent>
+#include <QImage>
+#include <new>
 
 int
 main(int argc, char **argv)
@@ -116,6 +122,234 @@ debugSlot(int value)
 
 //-------
 
+LayoutCache::
+LayoutCache(std::size_t maxBytes) :
+ maxBytes_(maxBytes)
+{
+}
+
+void
+LayoutCache::
+setMaxBytes(std::size_t n)
+{
+  maxBytes_ = n;
+
+  evict();
+}
+
+LayoutP
+LayoutCache::
+find(const Layout &request)
+{
+  auto p = layoutMap_.find(request.factor);
+
+  if (p == layoutMap_.end())
+    return LayoutP();
+
+  auto layout = *(*p).second;
+
+  // options changed (e.g. resize) so no cached layouts can be used
+  if (! layout->isSameOptions(request)) {
+    clear();
+    return LayoutP();
+  }
+
+  // move to front (most recently used)
+  layouts_.splice(layouts_.begin(), layouts_, (*p).second);
+
+  return layout;
+}
+
+bool
+LayoutCache::
+contains(const Layout &request) const
+{
+  auto p = layoutMap_.find(request.factor);
+
+  return (p != layoutMap_.end() && (*(*p).second)->isSameOptions(request));
+}
+
+void
+LayoutCache::
+add(const LayoutP &layout)
+{
+  auto p = layoutMap_.find(layout->factor);
+
+  if (p != layoutMap_.end())
+    remove(p);
+
+  layouts_.push_front(layout);
+
+  layoutMap_[layout->factor] = layouts_.begin();
+
+  memUsage_ += layout->memUsage();
+
+  evict();
+}
+
+void
+LayoutCache::
+clear()
+{
+  layouts_  .clear();
+  layoutMap_.clear();
+
+  memUsage_ = 0;
+}
+
+void
+LayoutCache::
+remove(LayoutMap::iterator p)
+{
+  memUsage_ -= (*(*p).second)->memUsage();
+
+  layouts_.erase((*p).second);
+
+  layoutMap_.erase(p);
+}
+
+void
+LayoutCache::
+evict()
+{
+  // remove least recently used until under memory limit
+  while (! layouts_.empty() && memUsage_ > maxBytes_)
+    remove(layoutMap_.find(layouts_.back()->factor));
+}
+
+//-------
+
+bool
+SpriteAtlas::
+getSprite(const QColor &c, double d, Sprite &sprite)
+{
+  // diameter bucket (steps of 2^(1/4))
+  int k = (d > 1.0 ? int(std::ceil(4.0*std::log2(d))) : 0);
+
+  // key is 5 bits per color channel and bucket
+  auto key = uint32_t(((c.red() >> 3) << 18) | ((c.green() >> 3) << 13) |
+                      ((c.blue() >> 3) << 8) | k);
+
+  auto p = sprites_.find(key);
+
+  if (p != sprites_.end()) {
+    sprite = (*p).second;
+    return true;
+  }
+
+  //---
+
+  // add to current shelf, new shelf or new page
+  int D    = int(std::ceil(std::pow(2.0, k/4.0)));
+  int cell = D + 2;
+
+  if (pages_.empty() || pages_.back().x + cell > PageSize) {
+    if (! pages_.empty()) {
+      auto &page = pages_.back();
+
+      page.y          += page.shelfHeight;
+      page.x           = 0;
+      page.shelfHeight = 0;
+    }
+
+    if (pages_.empty() || pages_.back().y + cell > PageSize) {
+      if (int(pages_.size()) >= MaxPages)
+        return false;
+
+      pages_.emplace_back();
+
+      auto &page = pages_.back();
+
+      page.pixmap = QPixmap(PageSize, PageSize);
+
+      page.pixmap.fill(Qt::transparent);
+    }
+  }
+
+  auto &page = pages_.back();
+
+  // draw opaque disc (alpha applied as fragment opacity)
+  {
+    QPainter painter(&page.pixmap);
+
+    painter.setRenderHint(QPainter::Antialiasing, true);
+
+    painter.setPen  (Qt::NoPen);
+    painter.setBrush(QColor(c.red(), c.green(), c.blue()));
+
+    painter.drawEllipse(QRectF(page.x + 1, page.y + 1, D, D));
+  }
+
+  sprite.page     = int(pages_.size()) - 1;
+  sprite.rect     = QRectF(page.x, page.y, cell, cell);
+  sprite.diameter = D;
+
+  page.x           += cell;
+  page.shelfHeight  = std::max(page.shelfHeight, cell);
+
+  sprites_[key] = sprite;
+
+  return true;
+}
+
+void
+SpriteAtlas::
+clear()
+{
+  pages_  .clear();
+  sprites_.clear();
+}
+
+//-------
+
+LayoutWorker::
+LayoutWorker(std::size_t numThreads)
+{
+  circleMgr_.setNumThreads(numThreads);
+}
+
+void
+LayoutWorker::
+calcLayout(CQFactor::LayoutP layout)
+{
+  // skip requests replaced while queued
+  if (layout->generation != latest_)
+    return;
+
+  circleMgr_.setLayout(layout.get(), &latest_);
+
+  circleMgr_.setDebug (layout->debug);
+  circleMgr_.setFactor(layout->factor);
+
+  double w = layout->size.width ();
+  double h = layout->size.height();
+
+  // a draw circle is stored per point so very large values may not fit in memory,
+  // draw nothing for these rather than terminating
+  try {
+    circleMgr_.calc();
+
+    circleMgr_.setCenter(CCircleFactor::Point(w/2, h/2));
+
+    circleMgr_.generate(w, h);
+  }
+  catch (const std::bad_alloc &) {
+    DrawCircleDatas().swap(layout->drawCircles);
+    DrawCircleDatas().swap(layout->debugCircles);
+  }
+
+  layout->factors = circleMgr_.factors();
+
+  bool cancelled = circleMgr_.isCancelled();
+
+  circleMgr_.setLayout(nullptr, nullptr);
+
+  if (! cancelled)
+    emit layoutDone(layout);
+}
+
+//-------
+
 App::
 App(QWidget *parent) :
  QWidget(parent)
@@ -126,14 +360,51 @@ App(QWidget *parent) :
 
   setMinimumSize(QSize(400, 400));
 
-  circleMgr_ = new AppCircleMgr(this);
+  // calculate layouts in background thread, results are returned by queued signal
+  qRegisterMetaType<CQFactor::LayoutP>("CQFactor::LayoutP");
+
+  layoutThread_ = new QThread;
+  layoutWorker_ = new LayoutWorker;
+
+  layoutWorker_->moveToThread(layoutThread_);
+
+  connect(layoutThread_, SIGNAL(finished()), layoutWorker_, SLOT(deleteLater()));
+
+  connect(layoutWorker_, SIGNAL(layoutDone(CQFactor::LayoutP)),
+          this, SLOT(layoutSlot(CQFactor::LayoutP)), Qt::QueuedConnection);
+
+  layoutThread_->start();
 
-  calc();
+  // calculate layouts of neighbouring values in single low priority thread
+  prefetchThread_ = new QThread;
+  prefetchWorker_ = new LayoutWorker(1);
+
+  prefetchWorker_->moveToThread(prefetchThread_);
+
+  connect(prefetchThread_, SIGNAL(finished()), prefetchWorker_, SLOT(deleteLater()));
+
+  connect(prefetchWorker_, SIGNAL(layoutDone(CQFactor::LayoutP)),
+          this, SLOT(prefetchSlot(CQFactor::LayoutP)), Qt::QueuedConnection);
+
+  prefetchThread_->start(QThread::LowPriority);
 }
 
 App::
 ~App()
 {
+  // cancel current layouts and wait for threads to finish
+  layoutWorker_  ->setLatest(-1);
+  prefetchWorker_->setLatest(-1);
+
+  layoutThread_  ->quit();
+  prefetchThread_->quit();
+
+  layoutThread_  ->wait();
+  prefetchThread_->wait();
+
+  delete layoutThread_;
+  delete prefetchThread_;
+
   reset();
 }
 
@@ -143,17 +414,45 @@ setDebug(bool debug)
 {
   debug_ = debug;
 
-  circleMgr_->setDebug(debug_);
-
   applyFactor();
 }
 
+void
+App::
+setHsvSaturation(double r)
+{
+  hsvSaturation_ = r;
+
+  // colors are part of layout
+  applyFactor(/*animate*/false);
+}
+
+void
+App::
+setHsvValue(double r)
+{
+  hsvValue_ = r;
+
+  applyFactor(/*animate*/false);
+}
+
+void
+App::
+setRenderMode(const RenderMode &m)
+{
+  renderMode_ = m;
+
+  invalidateFrame();
+}
+
 void
 App::
 addTimer()
 {
   animateTimer_ = new QTimer;
 
+  animateTimer_->setTimerType(Qt::PreciseTimer);
+
   connect(animateTimer_, SIGNAL(timeout()), this, SLOT(animateSlot()));
 }
 
@@ -161,104 +460,264 @@ void
 App::
 reset()
 {
-  circleMgr_->reset();
+  drawCircles_   .clear();
+  debugCircles_  .clear();
+  oldDrawCircles_.clear();
+
+  layoutCache_.clear();
 }
 
 void
 App::
 addDrawCircle(const QRectF &r, const QColor &pen, const QColor &brush)
 {
+  // old data is set when matched to old circles
   drawCircles_.emplace_back(r, pen, brush);
+}
 
-  auto &drawCircle = drawCircles_.back();
-
-  if (oldInd_ < int(oldDrawCircles_.size())) {
-    // update exiting old to existing circle
-    auto &oldDrawCircle = oldDrawCircles_[size_t(oldInd_)];
+void
+App::
+addDebugCircle(const QRectF &r, const QColor &pen, const QColor &brush)
+{
+  debugCircles_.emplace_back(r, pen, brush);
+}
 
-    drawCircle.oldData = oldDrawCircle.data;
+void
+App::
+factorEntered(int i)
+{
+  if (i != factor_) {
+    factor_ = i;
 
-    ++oldInd_;
+    applyFactor();
   }
-  else {
-    // add new circle at center
-    double xc = width ()/2;
-    double yc = height()/2;
+}
+
+void
+App::
+applyFactor(bool animate)
+{
+  if (factor_ <= 0)
+    return;
+
+  // request layout (cancels previous request), current circles are drawn until done
+  auto layout = makeLayout(factor_, animate);
+
+  layout->generation = ++generation_;
+
+  layoutWorker_->setLatest(generation_);
+
+  // stop prefetch so it doesn't compete with new layout
+  cancelPrefetch();
+
+  // use cached (prefetched) layout if available
+  auto cached = layoutCache_.find(*layout);
+
+  if (cached) {
+    applyLayout(*cached, animate);
+
+    prefetch();
 
-    drawCircle.oldData.rect  = QRectF(xc - r.width()/2, yc - r.height()/2, r.width(), r.height());
-    drawCircle.oldData.pen   = QColor(0, 0, 0, 0);
-    drawCircle.oldData.brush = QColor(0, 0, 0, 0);
+    return;
   }
+
+  QMetaObject::invokeMethod(layoutWorker_, "calcLayout", Qt::QueuedConnection,
+                            Q_ARG(CQFactor::LayoutP, layout));
 }
 
-void
+LayoutP
 App::
-addDebugCircle(const QRectF &r, const QColor &pen, const QColor &brush)
+makeLayout(int factor, bool animate) const
 {
-  debugCircles_.emplace_back(r, pen, brush);
+  auto layout = std::make_shared<Layout>();
+
+  layout->factor        = factor;
+  layout->size          = size();
+  layout->debug         = debug_;
+  layout->hsvSaturation = hsvSaturation_;
+  layout->hsvValue      = hsvValue_;
+  layout->animate       = animate;
+
+  return layout;
 }
 
 void
 App::
-factorEntered(int i)
+layoutSlot(CQFactor::LayoutP layout)
 {
-  auto factor = circleMgr_->factor();
+  // ignore result of replaced request
+  if (layout->generation != generation_)
+    return;
 
-  if (i != factor) {
-    circleMgr_->setFactor(i);
+  layoutCache_.add(layout);
 
-    applyFactor();
-  }
+  applyLayout(*layout, layout->animate);
+
+  prefetch();
 }
 
 void
 App::
-applyFactor()
+prefetchSlot(CQFactor::LayoutP layout)
 {
-  calc();
+  // ignore results of cancelled prefetch
+  if (layout->generation != prefetchGeneration_)
+    return;
 
-  //---
+  layoutCache_.add(layout);
+}
 
+void
+App::
+applyLayout(const Layout &layout, bool animate)
+{
   saveOld();
 
-  generate();
+  drawCircles_ .clear();
+  debugCircles_.clear();
+
+  for (const auto &data : layout.drawCircles)
+    addDrawCircle(data.rect, data.pen, data.brush);
+
+  for (const auto &data : layout.debugCircles)
+    addDebugCircle(data.rect, data.pen, data.brush);
 
   //---
 
-  addFadeOut();
+  matchOld();
 
   //---
 
-  animate();
+  if (animate)
+    this->animate();
+  else
+    resetFade();
 
   //---
 
-  update();
+  displayFactor_  = layout.factor;
+  displayFactors_ = layout.factors;
+
+  invalidateFrame();
+}
+
+void
+App::
+prefetch()
+{
+  cancelPrefetch();
+
+  if (prefetchCount_ <= 0)
+    return;
+
+  // only prefetch layouts which all fit in cache
+  auto maxCircles = layoutCache_.maxBytes()/(2*std::size_t(prefetchCount_)*
+                                             sizeof(DrawCircleData));
+
+  // nearest values first, alternating above and below
+  for (int d = 1; d <= prefetchCount_; ++d) {
+    for (int64_t factor : { int64_t(factor_) + d, int64_t(factor_) - d }) {
+      if (factor <= 0 || factor > INT_MAX || std::size_t(factor) > maxCircles)
+        continue;
+
+      auto layout = makeLayout(int(factor), /*animate*/true);
+
+      if (layoutCache_.contains(*layout))
+        continue;
+
+      layout->generation = prefetchGeneration_;
+
+      QMetaObject::invokeMethod(prefetchWorker_, "calcLayout", Qt::QueuedConnection,
+                                Q_ARG(CQFactor::LayoutP, layout));
+    }
+  }
+}
+
+void
+App::
+cancelPrefetch()
+{
+  prefetchWorker_->setLatest(++prefetchGeneration_);
 }
 
 void
 App::
 saveOld()
 {
-  oldDrawCircles_ = drawCircles_;
-  oldInd_         = 0;
+  // skip faded out circles of previous layout
+  oldDrawCircles_.clear();
+
+  for (const auto &drawCircle : drawCircles_) {
+    const auto &data = drawCircle.data;
+
+    if (data.pen.alpha() > 0 || data.brush.alpha() > 0)
+      oldDrawCircles_.push_back(drawCircle);
+  }
 }
 
 void
 App::
-addFadeOut()
+matchOld()
 {
-  auto n1 = int(oldDrawCircles_.size());
-  auto n2 = int(drawCircles_   .size());
+  // pair new circles with nearest old circle (by center)
+  auto n1 = oldDrawCircles_.size();
+  auto n2 = drawCircles_   .size();
 
-  int nfade = n1 - n2;
+  std::vector<double> x1(n1), y1(n1), x2(n2), y2(n2);
+
+  for (std::size_t i = 0; i < n1; ++i) {
+    auto c = oldDrawCircles_[i].data.rect.center();
+
+    x1[i] = c.x(); y1[i] = c.y();
+  }
+
+  for (std::size_t i = 0; i < n2; ++i) {
+    auto c = drawCircles_[i].data.rect.center();
+
+    x2[i] = c.x(); y2[i] = c.y();
+  }
+
+  auto matches = CCircleMatch::match(x1.data(), y1.data(), n1, x2.data(), y2.data(), n2);
+
+  //---
+
+  std::vector<bool> matched(n1, false);
+
+  for (std::size_t i = 0; i < n2; ++i) {
+    auto &drawCircle = drawCircles_[i];
+
+    int j = matches[i];
+
+    if (j >= 0) {
+      // move matched old circle to new circle
+      drawCircle.oldData = oldDrawCircles_[size_t(j)].data;
+
+      matched[size_t(j)] = true;
+    }
+    else {
+      // fade in unmatched new circle in place
+      auto transparent = [](const QColor &c) {
+        return QColor(c.red(), c.green(), c.blue(), 0);
+      };
+
+      drawCircle.oldData.rect  = drawCircle.data.rect;
+      drawCircle.oldData.pen   = transparent(drawCircle.data.pen  );
+      drawCircle.oldData.brush = transparent(drawCircle.data.brush);
+    }
+  }
+
+  // shrink and fade out unmatched old circles in place
+  for (std::size_t j = 0; j < n1; ++j) {
+    if (matched[j])
+      continue;
 
-  for (int i = 0; i < nfade; ++i) {
     DrawCircle drawCircle;
 
-    drawCircle.oldData = oldDrawCircles_[size_t(n2 + i)].data;
+    drawCircle.oldData = oldDrawCircles_[j].data;
+
+    auto c = drawCircle.oldData.rect.center();
 
-    drawCircle.data.rect  = QRectF(width()/2, height()/2, 0.1, 0.1);
+    drawCircle.data.rect  = QRectF(c.x() - 0.05, c.y() - 0.05, 0.1, 0.1);
     drawCircle.data.pen   = QColor(0, 0, 0, 0);
     drawCircle.data.brush = QColor(0, 0, 0, 0);
 
@@ -282,49 +741,112 @@ App::
 animate()
 {
   if (animateTimer_) {
-    animateCount_ = 0;
+    // load animation state (circles not animating stay at target)
+    auto n = drawCircles_.size();
+
+    anim_.resize(n);
+
+    auto setData = [&](std::size_t i, const DrawCircleData &data, bool target) {
+      auto set = [&](CCircleAnim::Channel c, double v) {
+        if (target)
+          anim_.setTarget(c, i, float(v));
+        else
+          anim_.setStart (c, i, float(v));
+      };
+
+      auto c = data.rect.center();
+
+      set(CCircleAnim::XC     , c.x());
+      set(CCircleAnim::YC     , c.y());
+      set(CCircleAnim::WIDTH  , data.rect.width ());
+      set(CCircleAnim::HEIGHT , data.rect.height());
+      set(CCircleAnim::PEN_R  , data.pen  .red  ());
+      set(CCircleAnim::PEN_G  , data.pen  .green());
+      set(CCircleAnim::PEN_B  , data.pen  .blue ());
+      set(CCircleAnim::PEN_A  , data.pen  .alpha());
+      set(CCircleAnim::BRUSH_R, data.brush.red  ());
+      set(CCircleAnim::BRUSH_G, data.brush.green());
+      set(CCircleAnim::BRUSH_B, data.brush.blue ());
+      set(CCircleAnim::BRUSH_A, data.brush.alpha());
+    };
+
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto &drawCircle = drawCircles_[i];
+
+      setData(i, (drawCircle.oldData.rect.isValid() ? drawCircle.oldData : drawCircle.data),
+              false);
+      setData(i, drawCircle.data, true);
+    }
+
+    animFramePending_ = false;
+
+    animateClock_.start();
 
-    animateTimer_->start(10);
+    animateTimer_->start(std::max(frameInterval_, 1));
   }
 }
 
-void
+bool
 App::
-calc()
+isAnimating() const
 {
-  circleMgr_->calc();
+  return (animateTimer_ && animateTimer_->isActive());
 }
 
 void
 App::
-paintEvent(QPaintEvent *)
+paintEvent(QPaintEvent *e)
 {
   QPainter painter(this);
 
-  draw(&painter);
+  animFramePending_ = false;
+
+  if (isAnimating()) {
+    draw(&painter);
+    return;
+  }
+
+  // draw settled frame once and copy exposed region from it
+  double dpr = devicePixelRatioF();
+
+  QSize psize(int(width()*dpr), int(height()*dpr));
+
+  if (! frameValid_ || frameCache_.size() != psize) {
+    frameCache_ = QPixmap(psize);
+
+    frameCache_.setDevicePixelRatio(dpr);
+
+    frameCache_.fill(Qt::transparent);
+
+    QPainter framePainter(&frameCache_);
+
+    draw(&framePainter);
+
+    frameValid_ = true;
+  }
+
+  QRectF r(e->rect());
+
+  painter.drawPixmap(r, frameCache_,
+                     QRectF(r.x()*dpr, r.y()*dpr, r.width()*dpr, r.height()*dpr));
 }
 
 void
 App::
-resizeEvent(QResizeEvent *)
+invalidateFrame()
 {
-  applyFactor();
-
-  resetFade();
+  frameValid_ = false;
 
   update();
 }
 
 void
 App::
-generate()
+resizeEvent(QResizeEvent *)
 {
-  drawCircles_ .clear();
-  debugCircles_.clear();
-
-  circleMgr_->setCenter(CCircleFactor::Point(width()/2, height()/2));
+  invalidateFrame();
 
-  circleMgr_->generate(width(), height());
+  applyFactor(/*animate*/false);
 }
 
 void
@@ -338,45 +860,38 @@ void
 App::
 animateStep()
 {
-  auto interp = [](double from, double to, double d) {
-    return from + (to - from)*d;
-  };
+  // position from elapsed time so total animation time is fixed
+  double t = (animDuration_ > 0 ? double(animateClock_.elapsed())/animDuration_ : 1.0);
 
-  auto interpPoint = [&](const QPointF &from, const QPointF &to, double f) {
-    return QPointF(interp(from.x(), to.x(), f), interp(from.y(), to.y(), f));
-  };
+  if (t < 1.0 && anim_.size() == drawCircles_.size()) {
+    // skip if last frame not painted yet (frame dropped)
+    if (animFramePending_)
+      return;
 
-  auto interpSize = [&](const QSizeF &from, const QSizeF &to, double f) {
-    return QSizeF(interp(from.width (), to.width (), f),
-                  interp(from.height(), to.height(), f));
-  };
+    anim_.setPos(float(easePos(t)));
 
-  auto interpRect = [&](const QRectF &from, const QRectF &to, double f) {
-    auto c = interpPoint(from.center(), to.center(), f);
+    // update drawn (old) data from animation state
+    auto color = [&](CCircleAnim::Channel c, std::size_t i) {
+      auto v = [&](int j) { return int(anim_.value(CCircleAnim::Channel(c + j), i) + 0.5f); };
 
-    auto s = interpSize(from.size(), to.size(), f);
+      return QColor(v(0), v(1), v(2), v(3));
+    };
 
-    return QRectF(c.x() - s.width()/2, c.y() - s.height()/2, s.width(), s.height());
-  };
+    auto n = drawCircles_.size();
 
-  auto interpColor = [&](const QColor &from, QColor &to, double f) {
-    return QColor::fromRgbF(interp(from.redF  (), to.redF  (), f),
-                            interp(from.greenF(), to.greenF(), f),
-                            interp(from.blueF (), to.blueF (), f),
-                            interp(from.alphaF(), to.alphaF(), f));
-  };
+    for (std::size_t i = 0; i < n; ++i) {
+      auto &oldData = drawCircles_[i].oldData;
 
-  ++animateCount_;
+      if (! oldData.rect.isValid())
+        continue;
 
-  if (animateCount_ < animIterations()) {
-    double f = 1.0/(animIterations() - animateCount_);
+      double w = anim_.value(CCircleAnim::WIDTH , i);
+      double h = anim_.value(CCircleAnim::HEIGHT, i);
 
-    for (auto &drawCircle : drawCircles_) {
-      if (drawCircle.oldData.rect.isValid()) {
-        drawCircle.oldData.rect  = interpRect (drawCircle.oldData.rect , drawCircle.data.rect , f);
-        drawCircle.oldData.pen   = interpColor(drawCircle.oldData.pen  , drawCircle.data.pen  , f);
-        drawCircle.oldData.brush = interpColor(drawCircle.oldData.brush, drawCircle.data.brush, f);
-      }
+      oldData.rect  = QRectF(anim_.value(CCircleAnim::XC, i) - w/2,
+                             anim_.value(CCircleAnim::YC, i) - h/2, w, h);
+      oldData.pen   = color(CCircleAnim::PEN_R  , i);
+      oldData.brush = color(CCircleAnim::BRUSH_R, i);
     }
   }
   else {
@@ -384,12 +899,32 @@ animateStep()
       drawCircle.oldData.rect = QRectF();
     }
 
+    anim_.clear();
+
     animateTimer_->stop();
   }
 
+  animFramePending_ = true;
+
   update();
 }
 
+double
+App::
+easePos(double t) const
+{
+  t = std::min(std::max(t, 0.0), 1.0);
+
+  switch (animEasing_) {
+    case AnimEasing::EASE_IN_OUT:
+      return (t < 0.5 ? 4.0*t*t*t : 1.0 - 4.0*(1.0 - t)*(1.0 - t)*(1.0 - t));
+    case AnimEasing::EASE_OUT:
+      return 1.0 - (1.0 - t)*(1.0 - t)*(1.0 - t);
+    default:
+      return t;
+  }
+}
+
 void
 App::
 draw(QPainter *painter)
@@ -398,36 +933,27 @@ draw(QPainter *painter)
 
   painter->setRenderHint(QPainter::Antialiasing, true);
 
-  for (const auto &drawCircle : drawCircles_) {
-    if (drawCircle.oldData.rect.isValid()) {
-      painter->setPen  (drawCircle.oldData.pen);
-      painter->setBrush(drawCircle.oldData.brush);
-
-      painter->drawEllipse(drawCircle.oldData.rect);
-    }
-    else {
-      painter->setPen  (drawCircle.data.pen);
-      painter->setBrush(drawCircle.data.brush);
-
-      painter->drawEllipse(drawCircle.data.rect);
-    }
-  }
-
-  for (const auto &debugCircle : debugCircles_) {
-    painter->setPen  (debugCircle.data.pen);
-    painter->setBrush(debugCircle.data.brush);
-
-    painter->drawEllipse(debugCircle.data.rect);
-  }
+  if      (spriteAnimate_ && isAnimating())
+    drawSprites(painter);
+  else if (renderMode_ == RenderMode::TILED ||
+           (! isAnimating() && int(drawCircles_.size()) >= tileThreshold_))
+    drawTiled(painter);
+  else if (renderMode_ == RenderMode::BATCHED)
+    drawBatched(painter);
+  else
+    drawDirect(painter);
 
   //------
 
   // draw number and factors
-  auto factor = circleMgr_->factor();
+  if (displayFactor_ <= 0)
+    return;
+
+  auto factor = displayFactor_;
 
   auto factorStr = QString("%1").arg(factor);
 
-  const auto &factors = circleMgr_->factors();
+  const auto &factors = displayFactors_;
 
   auto nf = factors.size();
 
@@ -470,6 +996,300 @@ draw(QPainter *painter)
   painter->drawText(int(20 + td2), int(2*fm.height() + 20 - fm.descent()), factorsStr);
 }
 
+void
+App::
+drawDirect(QPainter *painter)
+{
+  for (const auto &drawCircle : drawCircles_) {
+    if (drawCircle.oldData.rect.isValid()) {
+      painter->setPen  (drawCircle.oldData.pen);
+      painter->setBrush(drawCircle.oldData.brush);
+
+      painter->drawEllipse(drawCircle.oldData.rect);
+    }
+    else {
+      painter->setPen  (drawCircle.data.pen);
+      painter->setBrush(drawCircle.data.brush);
+
+      painter->drawEllipse(drawCircle.data.rect);
+    }
+  }
+
+  for (const auto &debugCircle : debugCircles_) {
+    painter->setPen  (debugCircle.data.pen);
+    painter->setBrush(debugCircle.data.brush);
+
+    painter->drawEllipse(debugCircle.data.rect);
+  }
+}
+
+void
+App::
+drawBatched(QPainter *painter)
+{
+  // group circles by pen and brush color quantized to 5 bits per channel, and draw each
+  // group as single path (winding fill so overlapping circles are filled)
+  struct Group {
+    QColor       pen;
+    QColor       brush;
+    QPainterPath path;
+  };
+
+  std::vector<Group>                        groups;
+  std::unordered_map<uint64_t, std::size_t> groupInd;
+
+  auto quantize = [](const QColor &c) {
+    return uint64_t(((c.red  () >> 3) << 15) | ((c.green() >> 3) << 10) |
+                    ((c.blue () >> 3) <<  5) |  (c.alpha() >> 3));
+  };
+
+  auto addCircle = [&](const DrawCircleData &data) {
+    // skip invisible
+    if (data.pen.alpha() == 0 && data.brush.alpha() == 0)
+      return;
+
+    auto key = (quantize(data.pen) << 20) | quantize(data.brush);
+
+    auto p = groupInd.find(key);
+
+    if (p == groupInd.end()) {
+      p = groupInd.emplace(key, groups.size()).first;
+
+      groups.emplace_back();
+
+      auto &group = groups.back();
+
+      group.pen   = data.pen;
+      group.brush = data.brush;
+
+      group.path.setFillRule(Qt::WindingFill);
+    }
+
+    groups[(*p).second].path.addEllipse(data.rect);
+  };
+
+  auto drawGroups = [&]() {
+    for (const auto &group : groups) {
+      if (group.pen.alpha() == 0)
+        painter->fillPath(group.path, QBrush(group.brush));
+      else {
+        painter->setPen  (group.pen);
+        painter->setBrush(group.brush);
+
+        painter->drawPath(group.path);
+      }
+    }
+
+    groups  .clear();
+    groupInd.clear();
+  };
+
+  for (const auto &drawCircle : drawCircles_) {
+    if (drawCircle.oldData.rect.isValid())
+      addCircle(drawCircle.oldData);
+    else
+      addCircle(drawCircle.data);
+  }
+
+  drawGroups();
+
+  // debug circles on top
+  for (const auto &debugCircle : debugCircles_)
+    addCircle(debugCircle.data);
+
+  drawGroups();
+}
+
+void
+App::
+drawSprites(QPainter *painter)
+{
+  // fragments to draw for each atlas page
+  using Fragments = std::vector<QPainter::PixmapFragment>;
+
+  std::vector<Fragments> pageFragments(SpriteAtlas::MaxPages);
+
+  auto flush = [&]() {
+    for (int i = 0; i < spriteAtlas_.numPages(); ++i) {
+      auto &fragments = pageFragments[size_t(i)];
+
+      if (fragments.empty())
+        continue;
+
+      painter->drawPixmapFragments(fragments.data(), int(fragments.size()),
+                                   spriteAtlas_.page(i));
+
+      fragments.clear();
+    }
+  };
+
+  SpriteAtlas::Sprite sprite;
+
+  for (const auto &drawCircle : drawCircles_) {
+    const auto &data = (drawCircle.oldData.rect.isValid() ?
+                        drawCircle.oldData : drawCircle.data);
+
+    if (data.pen.alpha() == 0 && data.brush.alpha() == 0)
+      continue;
+
+    double d = data.rect.width();
+
+    bool drawn = false;
+
+    // sprite for filled circle (draw pending and restart atlas if full)
+    if (data.pen.alpha() == 0 && d <= SpriteAtlas::MaxDiameter &&
+        data.rect.height() == d) {
+      bool found = spriteAtlas_.getSprite(data.brush, d, sprite);
+
+      if (! found) {
+        flush();
+
+        spriteAtlas_.clear();
+
+        found = spriteAtlas_.getSprite(data.brush, d, sprite);
+      }
+
+      if (found) {
+        double s = d/sprite.diameter;
+
+        pageFragments[size_t(sprite.page)].push_back(
+          QPainter::PixmapFragment::create(data.rect.center(), sprite.rect, s, s, 0.0,
+                                           data.brush.alphaF()));
+
+        drawn = true;
+      }
+    }
+
+    if (! drawn) {
+      painter->setPen  (data.pen);
+      painter->setBrush(data.brush);
+
+      painter->drawEllipse(data.rect);
+    }
+  }
+
+  flush();
+
+  for (const auto &debugCircle : debugCircles_) {
+    painter->setPen  (debugCircle.data.pen);
+    painter->setBrush(debugCircle.data.brush);
+
+    painter->drawEllipse(debugCircle.data.rect);
+  }
+}
+
+void
+App::
+drawTiled(QPainter *painter)
+{
+  // split device into fixed size tiles (integer device pixel offsets so each tile is
+  // rasterized exactly as the same area of a single image)
+  double dpr = devicePixelRatioF();
+
+  int pw = int(std::ceil(width ()*dpr));
+  int ph = int(std::ceil(height()*dpr));
+
+  int ts = std::max(tileSize_, 16);
+
+  int nx = (pw + ts - 1)/ts;
+  int ny = (ph + ts - 1)/ts;
+
+  if (nx <= 0 || ny <= 0)
+    return;
+
+  //---
+
+  // bin circles (in draw order) into tiles overlapped by their bounding rect extended
+  // by pen and antialiasing border
+  using TileCircles = std::vector<const DrawCircleData *>;
+
+  std::vector<TileCircles> tileCircles(size_t(nx*ny));
+
+  auto binCircle = [&](const DrawCircleData &data) {
+    if (data.pen.alpha() == 0 && data.brush.alpha() == 0)
+      return;
+
+    double b = (data.pen.alpha() > 0 ? 1.0 : 0.0)*dpr + 1.0;
+
+    const auto &r = data.rect;
+
+    int tx1 = std::max(int(std::floor((r.left  ()*dpr - b)/ts)), 0);
+    int ty1 = std::max(int(std::floor((r.top   ()*dpr - b)/ts)), 0);
+    int tx2 = std::min(int(std::floor((r.right ()*dpr + b)/ts)), nx - 1);
+    int ty2 = std::min(int(std::floor((r.bottom()*dpr + b)/ts)), ny - 1);
+
+    for (int ty = ty1; ty <= ty2; ++ty)
+      for (int tx = tx1; tx <= tx2; ++tx)
+        tileCircles[size_t(ty*nx + tx)].push_back(&data);
+  };
+
+  for (const auto &drawCircle : drawCircles_) {
+    if (drawCircle.oldData.rect.isValid())
+      binCircle(drawCircle.oldData);
+    else
+      binCircle(drawCircle.data);
+  }
+
+  for (const auto &debugCircle : debugCircles_)
+    binCircle(debugCircle.data);
+
+  //---
+
+  // draw tiles in parallel
+  if (! tilePool_)
+    tilePool_ = std::make_unique<CWorkPool>();
+
+  std::vector<QImage> tileImages(tileCircles.size());
+
+  tilePool_->parallelFor(tileCircles.size(), [&](std::size_t i) {
+    const auto &circles = tileCircles[i];
+
+    if (circles.empty())
+      return;
+
+    int tx = int(i) % nx;
+    int ty = int(i) / nx;
+
+    auto &image = tileImages[i];
+
+    image = QImage(std::min(ts, pw - tx*ts), std::min(ts, ph - ty*ts),
+                   QImage::Format_ARGB32_Premultiplied);
+
+    image.fill(Qt::transparent);
+
+    QPainter tilePainter(&image);
+
+    tilePainter.setRenderHint(QPainter::Antialiasing, true);
+
+    tilePainter.translate(-tx*ts, -ty*ts);
+    tilePainter.scale(dpr, dpr);
+
+    for (const auto *data : circles) {
+      tilePainter.setPen  (data->pen);
+      tilePainter.setBrush(data->brush);
+
+      tilePainter.drawEllipse(data->rect);
+    }
+  });
+
+  //---
+
+  // composite tiles
+  for (std::size_t i = 0; i < tileImages.size(); ++i) {
+    auto &image = tileImages[i];
+
+    if (image.isNull())
+      continue;
+
+    int tx = int(i) % nx;
+    int ty = int(i) / nx;
+
+    image.setDevicePixelRatio(dpr);
+
+    painter->drawImage(QPointF(tx*ts/dpr, ty*ts/dpr), image);
+  }
+}
+
 //---
 
 }
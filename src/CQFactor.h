@@ -1,10 +1,19 @@
 #ifndef CQFactor_H
 #define CQFactor_H
 
+#include <CCircleAnim.h>
 #include <CCircleFactor.h>
+#include <CWorkPool.h>
+#include <QPixmap>
 #include <QWidget>
+#include <QElapsedTimer>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <unordered_map>
 
 class QSpinBox;
+class QThread;
 class QTimer;
 
 namespace CQFactor {
@@ -60,15 +69,233 @@ struct DrawCircle {
 
 //---
 
-class AppCircleMgr;
+using DrawCircleDatas = std::vector<DrawCircleData>;
+
+// layout request and result (passed between App and LayoutWorker)
+struct Layout {
+  using Factors = CCircleFactor::CircleMgr::Factors;
+
+  // request
+  int    generation    { 0 };
+  int    factor        { 1 };
+  QSize  size;
+  bool   debug         { false };
+  double hsvSaturation { 0.6 };
+  double hsvValue      { 0.6 };
+  bool   animate       { true };
+
+  // result
+  Factors         factors;
+  DrawCircleDatas drawCircles;
+  DrawCircleDatas debugCircles;
+
+  // same options (result only depends on factor and options)
+  bool isSameOptions(const Layout &rhs) const {
+    return (size == rhs.size && debug == rhs.debug &&
+            hsvSaturation == rhs.hsvSaturation && hsvValue == rhs.hsvValue);
+  }
+
+  // approximate memory used
+  std::size_t memUsage() const {
+    return sizeof(Layout) + (drawCircles.capacity() + debugCircles.capacity())*
+                            sizeof(DrawCircleData);
+  }
+};
+
+using LayoutP = std::shared_ptr<Layout>;
+
+//---
+
+// Bounded LRU cache of calculated layouts keyed by factor (see CFactorCache).
+// Only used from GUI thread.
+class LayoutCache {
+ public:
+  LayoutCache(std::size_t maxBytes=(64 << 20));
+
+  //! max memory used by layouts
+  std::size_t maxBytes() const { return maxBytes_; }
+  void setMaxBytes(std::size_t n);
+
+  //! estimated memory used by layouts
+  std::size_t memUsage() const { return memUsage_; }
+
+  //! cached layout for request factor and options (null if none, cache is cleared if
+  //! options have changed)
+  LayoutP find(const Layout &request);
+
+  //! is layout for request factor and options cached
+  bool contains(const Layout &request) const;
+
+  void add(const LayoutP &layout);
+
+  void clear();
+
+ private:
+  using Layouts   = std::list<LayoutP>; // most recently used first
+  using LayoutMap = std::unordered_map<int, Layouts::iterator>;
+
+  void remove(LayoutMap::iterator p);
+
+  void evict();
+
+ private:
+  Layouts     layouts_;
+  LayoutMap   layoutMap_;
+  std::size_t maxBytes_ { 0 };
+  std::size_t memUsage_ { 0 };
+};
+
+//---
+
+// circle manager which collects draw circles for layout
+class AppCircleMgr : public CCircleFactor::CircleMgr {
+ public:
+  AppCircleMgr() { }
+
+  // layout to add circles to and latest requested generation (layout is cancelled
+  // when a newer one is requested)
+  void setLayout(Layout *layout, const std::atomic<int> *latest) {
+    layout_ = layout;
+    latest_ = latest;
+  }
+
+  void addDrawCircle(double xc, double yc, double size, double f) override {
+    QColor c;
+
+    double s = layout_->hsvSaturation;
+    double v = layout_->hsvValue;
+
+    c.setHsv(int(f*360.0), int(s*255.0), int(v*255.0));
+
+    layout_->drawCircles.emplace_back(QRectF(xc - size/2, yc - size/2, size, size),
+                                      QColor(0, 0, 0, 0), c);
+  }
+
+  void addDebugCircle(double xc, double yc, double size, double strokeAlpha,
+                      double fillAlpha) override {
+    layout_->debugCircles.emplace_back(QRectF(xc - size/2, yc - size/2, size, size),
+                                       QColor(0, 0, 0, int(255*strokeAlpha)),
+                                       QColor(0, 0, 0, int(255*fillAlpha)));
+  }
+
+  bool isCancelled() const override {
+    return (layout_ && latest_ && latest_->load() != layout_->generation);
+  }
+
+ private:
+  Layout*                 layout_ { nullptr };
+  const std::atomic<int>* latest_ { nullptr };
+};
+
+//---
+
+// Atlas of anti-aliased disc sprites for quantized color and diameter.
+//
+// Diameters are rounded up to steps of 2^(1/4) so sprites are only ever scaled down
+// (by at most 16%) when drawn. Sprites are created on first use and shelf packed into
+// fixed size pixmap pages. When all pages are full the atlas must be cleared.
+class SpriteAtlas {
+ public:
+  static constexpr int PageSize    = 1024;
+  static constexpr int MaxPages    = 8;
+  static constexpr int MaxDiameter = 256;
+
+  struct Sprite {
+    int    page     { 0 };
+    QRectF rect;           // source rect in page (disc plus 1 pixel border)
+    double diameter { 0 }; // disc diameter
+  };
+
+ public:
+  SpriteAtlas() { }
+
+  //! get sprite for color (alpha ignored) of at least diameter d (<= MaxDiameter),
+  //! returns false if atlas is full
+  bool getSprite(const QColor &c, double d, Sprite &sprite);
+
+  int numPages() const { return int(pages_.size()); }
+
+  const QPixmap &page(int i) const { return pages_[size_t(i)].pixmap; }
+
+  void clear();
+
+ private:
+  struct Page {
+    QPixmap pixmap;
+    int     x           { 0 }; // current shelf position
+    int     y           { 0 };
+    int     shelfHeight { 0 };
+  };
+
+  using Pages   = std::vector<Page>;
+  using Sprites = std::unordered_map<uint32_t, Sprite>;
+
+  Pages   pages_;
+  Sprites sprites_;
+};
+
+//---
+
+// calculates layouts in background thread
+class LayoutWorker : public QObject {
+  Q_OBJECT
+
+ public:
+  // number of threads for placement (0 for all cores)
+  LayoutWorker(std::size_t numThreads=0);
+
+  // set latest requested generation (called from GUI thread)
+  void setLatest(int generation) { latest_ = generation; }
+
+ public Q_SLOTS:
+  void calcLayout(CQFactor::LayoutP layout);
+
+ Q_SIGNALS:
+  void layoutDone(CQFactor::LayoutP layout);
+
+ private:
+  AppCircleMgr     circleMgr_;
+  std::atomic<int> latest_ { 0 };
+};
+
+//---
 
 class App : public QWidget {
   Q_OBJECT
 
   Q_PROPERTY(bool   debug          READ isDebug        WRITE setDebug         )
-  Q_PROPERTY(int    animIterations READ animIterations WRITE setAnimIterations)
+  Q_PROPERTY(int    animDuration   READ animDuration   WRITE setAnimDuration  )
+  Q_PROPERTY(int    frameInterval  READ frameInterval  WRITE setFrameInterval )
   Q_PROPERTY(double hsvSaturation  READ hsvSaturation  WRITE setHsvSaturation )
   Q_PROPERTY(double hsvValue       READ hsvValue       WRITE setHsvValue      )
+  Q_PROPERTY(int    prefetchCount  READ prefetchCount  WRITE setPrefetchCount )
+  Q_PROPERTY(bool   spriteAnimate  READ isSpriteAnimate WRITE setSpriteAnimate)
+  Q_PROPERTY(int    tileThreshold  READ tileThreshold  WRITE setTileThreshold )
+
+  Q_PROPERTY(RenderMode renderMode READ renderMode WRITE setRenderMode)
+  Q_PROPERTY(AnimEasing animEasing READ animEasing WRITE setAnimEasing)
+
+ public:
+  // how circles are drawn:
+  //   DIRECT  : set pen and brush and draw ellipse for each circle
+  //   BATCHED : draw single path for all circles of same (quantized) pen and brush
+  //   TILED   : draw circles (as DIRECT) into image tiles in parallel and composite
+  enum class RenderMode {
+    DIRECT,
+    BATCHED,
+    TILED
+  };
+
+  Q_ENUM(RenderMode)
+
+  // animation position (0-1) for elapsed time fraction
+  enum class AnimEasing {
+    LINEAR,
+    EASE_IN_OUT, // cubic
+    EASE_OUT     // cubic
+  };
+
+  Q_ENUM(AnimEasing)
 
  public:
   App(QWidget *parent=0);
@@ -77,16 +304,41 @@ class App : public QWidget {
   bool isDebug() const { return debug_; }
   void setDebug(bool debug);
 
-  int animIterations() const { return animIterations_; }
-  void setAnimIterations(int i) { animIterations_ = i; }
+  // animation duration (ms)
+  int animDuration() const { return animDuration_; }
+  void setAnimDuration(int t) { animDuration_ = t; }
+
+  // minimum time between animation frames (ms)
+  int frameInterval() const { return frameInterval_; }
+  void setFrameInterval(int t) { frameInterval_ = t; }
+
+  const AnimEasing &animEasing() const { return animEasing_; }
+  void setAnimEasing(const AnimEasing &e) { animEasing_ = e; }
 
   double hsvSaturation() const { return hsvSaturation_; }
-  void setHsvSaturation(double r) { hsvSaturation_ = r; }
+  void setHsvSaturation(double r);
 
   double hsvValue() const { return hsvValue_; }
-  void setHsvValue(double r) { hsvValue_ = r; }
+  void setHsvValue(double r);
+
+  // number of layouts either side of current value calculated in background
+  int prefetchCount() const { return prefetchCount_; }
+  void setPrefetchCount(int n) { prefetchCount_ = n; }
+
+  LayoutCache &layoutCache() { return layoutCache_; }
 
-  AppCircleMgr *circleMgr() { return circleMgr_; }
+  const RenderMode &renderMode() const { return renderMode_; }
+  void setRenderMode(const RenderMode &m);
+
+  // draw animation frames using sprite atlas (settled frame uses render mode)
+  bool isSpriteAnimate() const { return spriteAnimate_; }
+  void setSpriteAnimate(bool b) { spriteAnimate_ = b; }
+
+  // number of circles above which settled frame is always drawn TILED
+  int tileThreshold() const { return tileThreshold_; }
+  void setTileThreshold(int n) { tileThreshold_ = n; invalidateFrame(); }
+
+  bool isAnimating() const;
 
   void addTimer();
 
@@ -100,84 +352,101 @@ class App : public QWidget {
   void factorEntered(int i);
 
  private:
-  void applyFactor();
+  void applyFactor(bool animate=true);
+
+  LayoutP makeLayout(int factor, bool animate) const;
+
+  void applyLayout(const Layout &layout, bool animate);
+
+  void prefetch();
+
+  void cancelPrefetch();
 
   void saveOld();
 
-  void addFadeOut();
+  void matchOld();
 
   void resetFade();
 
   void animate();
 
-  void calc();
-
   void paintEvent(QPaintEvent *) override;
 
   void resizeEvent(QResizeEvent *) override;
 
-  void generate();
-
   void animateStep();
 
+  double easePos(double t) const;
+
   void draw(QPainter *painter);
 
+  void drawDirect (QPainter *painter);
+  void drawBatched(QPainter *painter);
+  void drawSprites(QPainter *painter);
+  void drawTiled  (QPainter *painter);
+
+  void invalidateFrame();
+
  private Q_SLOTS:
   void animateSlot();
 
+  void layoutSlot(CQFactor::LayoutP layout);
+
+  void prefetchSlot(CQFactor::LayoutP layout);
+
  private:
   friend class Circle;
 
   using DrawCircles = std::vector<DrawCircle>;
+  using WorkPoolP   = std::unique_ptr<CWorkPool>;
 
   bool debug_ { false };
 
   double hsvSaturation_ { 0.6 };
   double hsvValue_      { 0.6 };
 
-  int     animIterations_ { 100 };
-  QTimer *animateTimer_   { nullptr };
-  int     animateCount_   { 0 };
-
-  AppCircleMgr *circleMgr_ { nullptr };
+  RenderMode  renderMode_    { RenderMode::BATCHED };
+  bool        spriteAnimate_ { true };
+  SpriteAtlas spriteAtlas_;
+  QPixmap     frameCache_;            // settled frame
+  bool        frameValid_ { false };
+
+  int       tileSize_      { 256 };     // tile size in device pixels
+  int       tileThreshold_ { 100000 };
+  WorkPoolP tilePool_;                  // threads for tile drawing
+
+  int           animDuration_     { 1000 };
+  int           frameInterval_    { 16 };
+  AnimEasing    animEasing_       { AnimEasing::EASE_IN_OUT };
+  QTimer*       animateTimer_     { nullptr };
+  QElapsedTimer animateClock_;                 // time since animation start
+  bool          animFramePending_ { false };   // animation frame not yet painted
+
+  int             factor_        { 0 }; // requested factor
+  int             displayFactor_ { 0 }; // displayed factor
+  Layout::Factors displayFactors_;      // displayed factors
+
+  QThread*      layoutThread_ { nullptr };
+  LayoutWorker* layoutWorker_ { nullptr };
+  int           generation_   { 0 };
+
+  // low priority layout of neighbouring values
+  QThread*      prefetchThread_     { nullptr };
+  LayoutWorker* prefetchWorker_     { nullptr };
+  int           prefetchGeneration_ { 0 };
+  int           prefetchCount_      { 2 };
+  LayoutCache   layoutCache_;
 
   DrawCircles drawCircles_;
   DrawCircles debugCircles_;
 
   DrawCircles oldDrawCircles_;
-  int         oldInd_  { 0 };
-};
-
-//---
-
-class AppCircleMgr : public CCircleFactor::CircleMgr {
- public:
-  AppCircleMgr(App *app) :
-   app_(app) {
-  }
 
-  void addDrawCircle(double xc, double yc, double size, double f) override {
-    QColor c;
-
-    double s = app_->hsvSaturation();
-    double v = app_->hsvValue();
-
-    c.setHsv(int(f*360.0), int(s*255.0), int(v*255.0));
-
-    app_->addDrawCircle(QRectF(xc - size/2, yc - size/2, size, size), QColor(0, 0, 0, 0), c);
-  }
-
-  void addDebugCircle(double xc, double yc, double size, double strokeAlpha,
-                      double fillAlpha) override {
-    app_->addDebugCircle(QRectF(xc - size/2, yc - size/2, size, size),
-                         QColor(0, 0, 0, int(255*strokeAlpha)),
-                         QColor(0, 0, 0, int(255*fillAlpha)));
-  }
-
- private:
-  App *app_ { nullptr };
+  CCircleAnim anim_; // animation state of draw circles (from oldData to data)
 };
 
 }
 
+Q_DECLARE_METATYPE(CQFactor::LayoutP)
+
 #endif
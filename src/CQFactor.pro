@@ -13,11 +13,37 @@ QMAKE_CXXFLAGS += -std=c++17
 # Input
 SOURCES += \
 CQFactor.cpp \
+CArena.cpp \
+CCircleAnim.cpp \
+CCircleFactor.cpp \
+CCircleInstance.cpp \
+CCircleMatch.cpp \
+CClosestPair.cpp \
+CDelaunay.cpp \
+CFactorCache.cpp \
 CPrime.cpp \
+CPrimeSieve.cpp \
+CPrimeSPF.cpp \
+CPrimeRho.cpp \
+CWorkPool.cpp \
 
 HEADERS += \
 CQFactor.h \
+CArena.h \
+CCircleDrawSink.h \
+CCircleAnim.h \
+CCircleFactor.h \
+CCircleInstance.h \
+CCircleMatch.h \
+CClosestPair.h \
+CDelaunay.h \
+CFactorCache.h \
 CPrime.h \
+CPrimeFactors.h \
+CPrimeSieve.h \
+CPrimeSPF.h \
+CPrimeRho.h \
+CWorkPool.h \
 
 DESTDIR     = ../bin
 OBJECTS_DIR = ../obj
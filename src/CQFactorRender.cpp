@@ -0,0 +1,384 @@
+#include <CQFactorRender.h>
+#include <CCircleMatch.h>
+
+#include <QGuiApplication>
+#include <QDir>
+#include <QImage>
+#include <QPainter>
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void
+usage()
+{
+  std::fprintf(stderr,
+    "Usage: CQFactorRender [-dir <dir>] [-size <n>] [-svg] [-threads <n>]\n"
+    "                      [-saturation <r>] [-value <r>] [-match] <start> [<end>]\n"
+    "\n"
+    "  -match : time matching circles of each number to the next number (as done\n"
+    "           when CQFactor animates) instead of rendering\n");
+}
+
+// time match of circles of each number in range to those of the next number
+int
+timeMatches(int start, int end, int size)
+{
+  CQFactorRender::Renderer renderer;
+
+  renderer.setSize(size);
+
+  using Coords = CQFactorRender::Renderer::Coords;
+
+  Coords x1, y1, x2, y2;
+
+  renderer.centers(start, x1, y1);
+
+  double maxSecs   = 0.0;
+  int    maxFactor = start;
+
+  for (int i = start; i <= end && i < INT_MAX; ++i) {
+    renderer.centers(i + 1, x2, y2);
+
+    auto t1 = std::chrono::steady_clock::now();
+
+    auto matches = CCircleMatch::match(x1.data(), y1.data(), x1.size(),
+                                       x2.data(), y2.data(), x2.size());
+
+    auto t2 = std::chrono::steady_clock::now();
+
+    double secs = std::chrono::duration<double>(t2 - t1).count();
+
+    std::printf("Matched %d -> %d (%zu -> %zu circles) in %.3fs\n",
+                i, i + 1, x1.size(), x2.size(), secs);
+
+    if (secs > maxSecs) {
+      maxSecs   = secs;
+      maxFactor = i;
+    }
+
+    std::swap(x1, x2);
+    std::swap(y1, y2);
+  }
+
+  std::printf("Slowest match %d -> %d in %.3fs\n", maxFactor, maxFactor + 1, maxSecs);
+
+  return 0;
+}
+
+}
+
+int
+main(int argc, char **argv)
+{
+  // no display needed for image rendering
+  if (! qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+  QGuiApplication app(argc, argv);
+
+  // application sets locale from environment, SVG numbers must use '.' decimal point
+  std::setlocale(LC_NUMERIC, "C");
+
+  using Format = CQFactorRender::Renderer::Format;
+
+  std::string dir        = ".";
+  int         size       = 800;
+  Format      format     = Format::PNG;
+  int         numThreads = 0;
+  double      saturation = 0.6;
+  double      value      = 0.6;
+  int         start      = 0;
+  int         end        = 0;
+  int         numValues  = 0;
+  bool        match      = false;
+
+  for (int i = 1; i < argc; ++i) {
+    auto hasArg = [&]() {
+      if (i + 1 < argc) return true;
+
+      std::fprintf(stderr, "Missing value for %s\n", argv[i]);
+
+      return false;
+    };
+
+    if      (std::strcmp(argv[i], "-dir") == 0) {
+      if (! hasArg()) return 1;
+
+      dir = argv[++i];
+    }
+    else if (std::strcmp(argv[i], "-size") == 0) {
+      if (! hasArg()) return 1;
+
+      size = std::atoi(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "-svg") == 0) {
+      format = Format::SVG;
+    }
+    else if (std::strcmp(argv[i], "-threads") == 0) {
+      if (! hasArg()) return 1;
+
+      numThreads = std::atoi(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "-saturation") == 0) {
+      if (! hasArg()) return 1;
+
+      saturation = std::atof(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "-value") == 0) {
+      if (! hasArg()) return 1;
+
+      value = std::atof(argv[++i]);
+    }
+    else if (std::strcmp(argv[i], "-match") == 0) {
+      match = true;
+    }
+    else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      usage();
+      return 1;
+    }
+    else {
+      if      (numValues == 0) start = std::atoi(argv[i]);
+      else if (numValues == 1) end   = std::atoi(argv[i]);
+      else { usage(); return 1; }
+
+      ++numValues;
+    }
+  }
+
+  if (numValues == 1)
+    end = start;
+
+  if (numValues == 0 || start <= 0 || end < start || size <= 0) {
+    usage();
+    return 1;
+  }
+
+  if (match)
+    return timeMatches(start, end, size);
+
+  if (! QDir().mkpath(QString::fromStdString(dir))) {
+    std::fprintf(stderr, "Failed to create directory %s\n", dir.c_str());
+    return 1;
+  }
+
+  //---
+
+  // render numbers in parallel, one renderer (circle manager) per thread
+  if (numThreads <= 0)
+    numThreads = int(std::max(1U, std::thread::hardware_concurrency()));
+
+  numThreads = std::min(numThreads, end - start + 1);
+
+  std::atomic<int> next      { start };
+  std::atomic<int> numFailed { 0 };
+
+  auto t1 = std::chrono::steady_clock::now();
+
+  auto renderProc = [&]() {
+    CQFactorRender::Renderer renderer;
+
+    renderer.setFormat       (format);
+    renderer.setDir          (dir);
+    renderer.setSize         (size);
+    renderer.setHsvSaturation(saturation);
+    renderer.setHsvValue     (value);
+
+    for (;;) {
+      int i = next++;
+
+      if (i > end)
+        break;
+
+      if (! renderer.render(i)) {
+        std::fprintf(stderr, "Failed to write %s\n", renderer.fileName(i).c_str());
+
+        ++numFailed;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+
+  for (int i = 1; i < numThreads; ++i)
+    threads.emplace_back(renderProc);
+
+  renderProc();
+
+  for (auto &thread : threads)
+    thread.join();
+
+  auto t2 = std::chrono::steady_clock::now();
+
+  //---
+
+  double secs = std::chrono::duration<double>(t2 - t1).count();
+
+  int numImages = end - start + 1 - numFailed;
+
+  std::printf("Rendered %d images in %.3fs (%.1f images/sec, %d threads)\n",
+              numImages, secs, (secs > 0.0 ? numImages/secs : 0.0), numThreads);
+
+  return (numFailed > 0 ? 1 : 0);
+}
+
+//------
+
+namespace CQFactorRender {
+
+Renderer::
+Renderer() :
+ drawSink_(DrawSink::make(this))
+{
+  setDrawSink(&drawSink_);
+}
+
+std::string
+Renderer::
+fileName(int factor) const
+{
+  return dir_ + "/" + std::to_string(factor) + (format_ == Format::SVG ? ".svg" : ".png");
+}
+
+bool
+Renderer::
+render(int factor)
+{
+  setFactor(factor);
+
+  calc();
+
+  setCenter(CCircleFactor::Point(size_/2.0, size_/2.0));
+
+  if (format_ == Format::SVG)
+    return renderSVG(factor);
+  else
+    return renderPNG(factor);
+}
+
+void
+Renderer::
+centers(int factor, Coords &x, Coords &y)
+{
+  x.clear();
+  y.clear();
+
+  setFactor(factor);
+
+  calc();
+
+  setCenter(CCircleFactor::Point(size_/2.0, size_/2.0));
+
+  centersX_ = &x;
+  centersY_ = &y;
+
+  generate(size_, size_);
+
+  centersX_ = nullptr;
+  centersY_ = nullptr;
+}
+
+bool
+Renderer::
+renderPNG(int factor)
+{
+  QImage image(size_, size_, QImage::Format_ARGB32_Premultiplied);
+
+  image.fill(Qt::white);
+
+  QPainter painter(&image);
+
+  painter.setRenderHint(QPainter::Antialiasing, true);
+
+  painter.setPen(Qt::NoPen);
+
+  painter_ = &painter;
+
+  generate(size_, size_);
+
+  painter_ = nullptr;
+
+  painter.end();
+
+  return image.save(QString::fromStdString(fileName(factor)), "PNG");
+}
+
+bool
+Renderer::
+renderSVG(int factor)
+{
+  auto name = fileName(factor);
+
+  svgFile_ = std::fopen(name.c_str(), "w");
+
+  if (! svgFile_)
+    return false;
+
+  std::fprintf(svgFile_,
+    "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\">\n"
+    "<rect width=\"100%%\" height=\"100%%\" fill=\"white\"/>\n", size_, size_);
+
+  generate(size_, size_);
+
+  std::fprintf(svgFile_, "</svg>\n");
+
+  bool rc = (std::ferror(svgFile_) == 0);
+
+  if (std::fclose(svgFile_) != 0)
+    rc = false;
+
+  svgFile_ = nullptr;
+
+  return rc;
+}
+
+void
+Renderer::
+drawChunk(const CCircleFactor::DrawRecord *records, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto &r = records[i];
+
+    if (centersX_) {
+      centersX_->push_back(r.x);
+      centersY_->push_back(r.y);
+
+      continue;
+    }
+
+    auto c = color(r.f);
+
+    if      (painter_) {
+      painter_->setBrush(c);
+
+      painter_->drawEllipse(QRectF(r.x - r.size/2, r.y - r.size/2, r.size, r.size));
+    }
+    else if (svgFile_) {
+      std::fprintf(svgFile_,
+                   "<circle cx=\"%.2f\" cy=\"%.2f\" r=\"%.2f\" fill=\"#%02x%02x%02x\"/>\n",
+                   r.x, r.y, r.size/2, c.red(), c.green(), c.blue());
+    }
+  }
+}
+
+QColor
+Renderer::
+color(double f) const
+{
+  // same as CQFactor::AppCircleMgr
+  QColor c;
+
+  c.setHsv(int(f*360.0), int(hsvSaturation_*255.0), int(hsvValue_*255.0));
+
+  return c;
+}
+
+}
@@ -0,0 +1,80 @@
+#ifndef CQFactorRender_H
+#define CQFactorRender_H
+
+#include <CCircleFactor.h>
+#include <QColor>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class QPainter;
+
+namespace CQFactorRender {
+
+// renders factor diagram for a number to PNG (QImage) or SVG file. Circles are streamed
+// to the output in chunks as they are generated (no draw list).
+class Renderer : public CCircleFactor::CircleMgr {
+ public:
+  enum class Format {
+    PNG,
+    SVG
+  };
+
+  using Coords = std::vector<double>;
+
+ public:
+  Renderer();
+
+  const Format &format() const { return format_; }
+  void setFormat(const Format &f) { format_ = f; }
+
+  // output directory
+  const std::string &dir() const { return dir_; }
+  void setDir(const std::string &dir) { dir_ = dir; }
+
+  // image width and height (pixels)
+  int size() const { return size_; }
+  void setSize(int s) { size_ = s; }
+
+  double hsvSaturation() const { return hsvSaturation_; }
+  void setHsvSaturation(double r) { hsvSaturation_ = r; }
+
+  double hsvValue() const { return hsvValue_; }
+  void setHsvValue(double r) { hsvValue_ = r; }
+
+  //! output file name for number
+  std::string fileName(int factor) const;
+
+  //! render number to output file, returns false on write error
+  bool render(int factor);
+
+  //! circle centers of number (as matched when CQFactor animates between numbers)
+  void centers(int factor, Coords &x, Coords &y);
+
+  // draw chunk of generated circles to current output
+  void drawChunk(const CCircleFactor::DrawRecord *records, std::size_t n);
+
+ private:
+  bool renderPNG(int factor);
+  bool renderSVG(int factor);
+
+  QColor color(double f) const;
+
+ private:
+  using DrawSink = CCircleFactor::DrawSink;
+
+  Format      format_        { Format::PNG };
+  std::string dir_           { "." };
+  int         size_          { 800 };
+  double      hsvSaturation_ { 0.6 };
+  double      hsvValue_      { 0.6 };
+  QPainter*   painter_       { nullptr }; // current PNG painter
+  std::FILE*  svgFile_       { nullptr }; // current SVG file
+  Coords*     centersX_      { nullptr }; // current circle centers
+  Coords*     centersY_      { nullptr };
+  DrawSink    drawSink_;
+};
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+TEMPLATE = app
+
+QT += gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = CQFactorRender
+
+DEPENDPATH += .
+
+QMAKE_CXXFLAGS += -std=c++17
+
+#CONFIG += debug
+
+# Input
+SOURCES += \
+CQFactorRender.cpp \
+CArena.cpp \
+CCircleFactor.cpp \
+CCircleInstance.cpp \
+CCircleMatch.cpp \
+CClosestPair.cpp \
+CDelaunay.cpp \
+CFactorCache.cpp \
+CPrime.cpp \
+CPrimeSieve.cpp \
+CPrimeSPF.cpp \
+CPrimeRho.cpp \
+CWorkPool.cpp \
+
+HEADERS += \
+CQFactorRender.h \
+CArena.h \
+CCircleDrawSink.h \
+CCircleFactor.h \
+CCircleInstance.h \
+CCircleMatch.h \
+CClosestPair.h \
+CDelaunay.h \
+CFactorCache.h \
+CPrime.h \
+CPrimeFactors.h \
+CPrimeSieve.h \
+CPrimeSPF.h \
+CPrimeRho.h \
+CWorkPool.h \
+
+DESTDIR     = ../bin
+OBJECTS_DIR = ../obj/render
+LIB_DIR     = ../lib
+
+INCLUDEPATH += \
+../include \
+.
+
+unix:LIBS += \
+-L$$LIB_DIR \
@@ -0,0 +1,170 @@
+#include <CWorkPool.h>
+
+#include <algorithm>
+
+namespace {
+
+// pool and queue of worker thread
+struct WorkerData {
+  const CWorkPool* pool { nullptr };
+  std::size_t      ind  { 0 };
+};
+
+thread_local WorkerData workerData;
+
+}
+
+CWorkPool::
+CWorkPool(std::size_t numThreads)
+{
+  if (numThreads == 0)
+    numThreads = std::max(1U, std::thread::hardware_concurrency());
+
+  for (std::size_t i = 0; i < numThreads; ++i)
+    queues_.push_back(std::make_unique<Queue>());
+
+  for (std::size_t i = 1; i < numThreads; ++i)
+    threads_.emplace_back([this, i]() { workerLoop(i); });
+}
+
+CWorkPool::
+~CWorkPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    stop_ = true;
+  }
+
+  cond_.notify_all();
+
+  for (auto &thread : threads_)
+    thread.join();
+}
+
+void
+CWorkPool::
+parallelFor(std::size_t n, const IndexProc &proc)
+{
+  if (n == 0)
+    return;
+
+  if (n == 1 || threads_.empty()) {
+    for (std::size_t i = 0; i < n; ++i)
+      proc(i);
+
+    return;
+  }
+
+  //---
+
+  std::atomic<std::size_t> pending { n - 1 };
+
+  auto ind = queueIndex();
+
+  // count before queueing so waiting workers never miss tasks
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    numTasks_ += n - 1;
+  }
+
+  // queue all but first (popped from back so pushed in reverse)
+  {
+    auto &queue = *queues_[ind];
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    for (std::size_t i = n - 1; i > 0; --i)
+      queue.tasks.push_back(Task { &proc, i, &pending });
+  }
+
+  cond_.notify_all();
+
+  proc(0);
+
+  // run queued tasks (ours or stolen) until all of ours are done
+  while (pending.load(std::memory_order_acquire) > 0) {
+    if (! runTask(ind))
+      std::this_thread::yield();
+  }
+}
+
+std::size_t
+CWorkPool::
+queueIndex() const
+{
+  return (workerData.pool == this ? workerData.ind : 0);
+}
+
+bool
+CWorkPool::
+runTask(std::size_t ind)
+{
+  Task task;
+
+  bool found = false;
+
+  // pop newest from own queue
+  {
+    auto &queue = *queues_[ind];
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (! queue.tasks.empty()) {
+      task = queue.tasks.back();
+
+      queue.tasks.pop_back();
+
+      found = true;
+    }
+  }
+
+  // steal oldest from other queues
+  auto nq = queues_.size();
+
+  for (std::size_t i = 1; ! found && i < nq; ++i) {
+    auto &queue = *queues_[(ind + i) % nq];
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (! queue.tasks.empty()) {
+      task = queue.tasks.front();
+
+      queue.tasks.pop_front();
+
+      found = true;
+    }
+  }
+
+  if (! found)
+    return false;
+
+  --numTasks_;
+
+  (*task.proc)(task.i);
+
+  task.pending->fetch_sub(1, std::memory_order_release);
+
+  return true;
+}
+
+void
+CWorkPool::
+workerLoop(std::size_t ind)
+{
+  workerData.pool = this;
+  workerData.ind  = ind;
+
+  for (;;) {
+    if (runTask(ind))
+      continue;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    cond_.wait(lock, [&]() { return stop_ || numTasks_ > 0; });
+
+    if (stop_)
+      break;
+  }
+}
@@ -0,0 +1,72 @@
+#ifndef CWorkPool_H
+#define CWorkPool_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work stealing thread pool.
+//
+// Each worker has its own task queue. New tasks are pushed to the back of the calling
+// worker's queue and run last in first out; idle workers steal from the front of other
+// queues. A thread waiting for its tasks runs queued tasks instead of blocking, so
+// parallelFor can be nested (e.g. from recursive tree code) without deadlock.
+//
+// Tasks must not throw.
+class CWorkPool {
+ public:
+  using IndexProc = std::function<void (std::size_t)>;
+
+ public:
+  // number of threads including caller (0 for hardware concurrency)
+  CWorkPool(std::size_t numThreads=0);
+
+ ~CWorkPool();
+
+  CWorkPool(const CWorkPool &) = delete;
+  CWorkPool &operator=(const CWorkPool &) = delete;
+
+  //! number of threads including caller
+  std::size_t numThreads() const { return threads_.size() + 1; }
+
+  //! call proc(i) for i in [0, n) and wait for completion
+  void parallelFor(std::size_t n, const IndexProc &proc);
+
+ private:
+  struct Task {
+    const IndexProc*          proc    { nullptr };
+    std::size_t               i       { 0 };
+    std::atomic<std::size_t> *pending { nullptr };
+  };
+
+  struct Queue {
+    std::mutex       mutex;
+    std::deque<Task> tasks;
+  };
+
+  using QueueP  = std::unique_ptr<Queue>;
+  using Queues  = std::vector<QueueP>;
+  using Threads = std::vector<std::thread>;
+
+  // queue of current thread (queue 0 is shared by non worker threads)
+  std::size_t queueIndex() const;
+
+  bool runTask(std::size_t ind);
+
+  void workerLoop(std::size_t ind);
+
+ private:
+  Queues                   queues_;
+  Threads                  threads_;
+  std::mutex               mutex_;
+  std::condition_variable  cond_;
+  std::atomic<std::size_t> numTasks_ { 0 };
+  std::atomic<bool>        stop_     { false };
+};
+
+#endif